@@ -0,0 +1,591 @@
+#ifndef VE281P1_CONVEX_HULL_HPP
+#define VE281P1_CONVEX_HULL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+#include "sort.hpp"
+#include "thread_pool.hpp"
+
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Convex hull of a set of integer points
+ * Coordinates must fit in 62 bits, so that every difference fits in int64_t
+ * and every cross product is computed exactly.
+ * Nothing here has state outside its arguments, so hulls can be computed concurrently.
+ */
+
+struct Point {
+    int64_t x;
+    int64_t y;
+
+    bool operator==(const Point &other) const { return x == other.x && y == other.y; }
+
+    bool operator!=(const Point &other) const { return !(*this == other); }
+};
+
+// sign of a * b - c * d, exact for any int64_t operands
+inline int compare_products(int64_t a, int64_t b, int64_t c, int64_t d) {
+#if defined(__SIZEOF_INT128__)
+    // __extension__ keeps -Wpedantic quiet about the non-standard type
+    __extension__ typedef __int128 int128_t;
+    int128_t left = (int128_t)a * b;
+    int128_t right = (int128_t)c * d;
+    return (left > right) - (left < right);
+#else
+    // signs first, then the 128-bit magnitudes from 32-bit limbs
+    int left_sign = (a > 0) - (a < 0);
+    left_sign *= (b > 0) - (b < 0);
+    int right_sign = (c > 0) - (c < 0);
+    right_sign *= (d > 0) - (d < 0);
+    if (left_sign != right_sign) {
+        return left_sign > right_sign ? 1 : -1;
+    }
+    if (left_sign == 0) {
+        return 0;
+    }
+    auto magnitude = [](int64_t v) { return v < 0 ? 0 - (uint64_t)v : (uint64_t)v; };
+    auto multiply = [](uint64_t u, uint64_t v, uint64_t &hi, uint64_t &lo) {
+        uint64_t u0 = u & 0xffffffffu, u1 = u >> 32, v0 = v & 0xffffffffu, v1 = v >> 32;
+        uint64_t p00 = u0 * v0, p01 = u0 * v1, p10 = u1 * v0, p11 = u1 * v1;
+        uint64_t middle = (p00 >> 32) + (p01 & 0xffffffffu) + (p10 & 0xffffffffu);
+        lo = (middle << 32) | (p00 & 0xffffffffu);
+        hi = p11 + (p01 >> 32) + (p10 >> 32) + (middle >> 32);
+    };
+    uint64_t left_hi, left_lo, right_hi, right_lo;
+    multiply(magnitude(a), magnitude(b), left_hi, left_lo);
+    multiply(magnitude(c), magnitude(d), right_hi, right_lo);
+    int order = left_hi != right_hi ? (left_hi > right_hi ? 1 : -1)
+                                    : (left_lo != right_lo ? (left_lo > right_lo ? 1 : -1) : 0);
+    return left_sign > 0 ? order : -order;
+#endif
+}
+
+/**
+ * Orientation of the turn p1 -> p2 -> p3
+ * @return 1 for a counter-clockwise turn, -1 for a clockwise turn, 0 if the points are collinear
+ */
+inline int ccw(const Point &p1, const Point &p2, const Point &p3) {
+    return compare_products(p2.x - p1.x, p3.y - p1.y, p2.y - p1.y, p3.x - p1.x);
+}
+
+// inputs shorter than this are hulled by one thread in convex_hull_monotone_chain
+static constexpr std::size_t HULL_PARALLEL_CUTOFF = 1 << 15;
+// the first group size of Chan's algorithm, squared after every failed round
+static constexpr std::size_t CHAN_INITIAL_GROUP = 16;
+// group hulls not longer than this are searched linearly for tangents
+static constexpr std::size_t CHAN_LINEAR_TANGENT = 8;
+
+enum class HullAlgorithm {
+    Graham,             // O(n log n), sorts by angle around the lowest point
+    Chan,               // O(n log h), output-sensitive
+    MonotoneChain       // O(n log n), sorts and builds the chains in parallel
+};
+
+// the order of the hull output: counter-clockwise, starting at the lowest (then leftmost) point
+inline bool hull_start_less(const Point &a, const Point &b) {
+    return a.y < b.y || (a.y == b.y && a.x < b.x);
+}
+
+// |dx| + |dy| from p to q, orders the points on one ray from p
+inline uint64_t ray_distance(const Point &p, const Point &q) {
+    return (uint64_t)(q.x < p.x ? p.x - q.x : q.x - p.x) + (uint64_t)(q.y < p.y ? p.y - q.y : q.y - p.y);
+}
+
+/*
+ * Akl-Toussaint prefilter
+ */
+
+// inputs shorter than this are not prefiltered by convex_hull_inplace
+static constexpr std::size_t HULL_FILTER_CUTOFF = 64;
+// points are tested against the octagon in chunks of this many, converted to doubles on the stack
+static constexpr std::size_t HULL_FILTER_CHUNK = 1024;
+
+/**
+ * The extreme points of [first, last) in the directions -y, x - y, x, x + y, y, y - x, -x, -x - y,
+ * which lie on the hull in this counter-clockwise order; repeated vertices are dropped
+ * @return the number of distinct vertices written to octagon
+ */
+inline std::size_t hull_octagon(const Point *first, const Point *last, Point octagon[8]) {
+    // 62-bit coordinates, so the sums and differences below cannot overflow
+    auto key = [](const Point &p, int direction) {
+        switch (direction) {
+            case 0: return -p.y;
+            case 1: return p.x - p.y;
+            case 2: return p.x;
+            case 3: return p.x + p.y;
+            case 4: return p.y;
+            case 5: return p.y - p.x;
+            case 6: return -p.x;
+            default: return -p.x - p.y;
+        }
+    };
+    const Point *extreme[8];
+    int64_t best[8];
+    for (int d = 0; d < 8; ++d) {
+        extreme[d] = first;
+        best[d] = key(*first, d);
+    }
+    for (const Point *p = first + 1; p != last; ++p) {
+        for (int d = 0; d < 8; ++d) {
+            int64_t value = key(*p, d);
+            if (value > best[d]) {
+                best[d] = value;
+                extreme[d] = p;
+            }
+        }
+    }
+    std::size_t k = 0;
+    for (int d = 0; d < 8; ++d) {
+        if (k == 0 || *extreme[d] != octagon[k - 1]) {
+            octagon[k++] = *extreme[d];
+        }
+    }
+    while (k > 1 && octagon[k - 1] == octagon[0]) {
+        k--;
+    }
+    return k;
+}
+
+#if defined(__AVX2__)
+
+/**
+ * Mark which of the n points (x[i], y[i]) lie strictly inside the convex polygon ax, ay (k vertices,
+ * counter-clockwise) with edges ex, ey: bit i of inside[i / 64] is set for a point inside
+ * The orientation is computed in doubles and only trusted beyond bound, so rounding can keep a point
+ * that is inside but never drops one that is not
+ */
+inline void hull_filter_kernel(const double *x, const double *y, std::size_t n,
+                               const double *ax, const double *ay, const double *ex, const double *ey,
+                               std::size_t k, double bound, uint64_t *inside) {
+    const __m256d limit = _mm256_set1_pd(bound);
+    for (std::size_t i = 0; i < n; i += 4) {
+        __m256d px = _mm256_loadu_pd(x + i);
+        __m256d py = _mm256_loadu_pd(y + i);
+        __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        for (std::size_t j = 0; j < k; ++j) {
+            __m256d dx = _mm256_sub_pd(px, _mm256_set1_pd(ax[j]));
+            __m256d dy = _mm256_sub_pd(py, _mm256_set1_pd(ay[j]));
+            __m256d cross = _mm256_sub_pd(_mm256_mul_pd(_mm256_set1_pd(ex[j]), dy),
+                                          _mm256_mul_pd(_mm256_set1_pd(ey[j]), dx));
+            all = _mm256_and_pd(all, _mm256_cmp_pd(cross, limit, _CMP_GT_OQ));
+        }
+        inside[i / 64] |= (uint64_t)_mm256_movemask_pd(all) << (i % 64);
+    }
+}
+
+#endif
+
+/**
+ * Akl-Toussaint heuristic: move the points of [first, last) that are not strictly inside the octagon
+ * of extreme points to the front, in their original order, and return how many there are
+ * The points dropped are strictly inside the hull, so the hull of the prefix is the hull of the input.
+ * With AVX2 the test is a vectorized double precision orientation kernel with a rounding margin,
+ * otherwise the exact ccw. O(n) time, no allocation
+ */
+inline std::size_t akl_toussaint_filter(Point *first, Point *last) {
+    std::size_t n = last - first;
+    if (n == 0) {
+        return 0;
+    }
+    Point octagon[8];
+    std::size_t k = hull_octagon(first, last, octagon);
+    if (k < 3) {
+        return n;
+    }
+    std::size_t kept = 0;
+#if defined(__AVX2__)
+    // coordinates relative to the first vertex are exact 63-bit integers, c bounds all of them
+    // and the rounding error of every orientation stays far below 64 eps c^2
+    auto magnitude = [](int64_t v) { return v < 0 ? 0 - (uint64_t)v : (uint64_t)v; };
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const Point origin = octagon[0];
+    uint64_t c = 1;
+    for (std::size_t j = 0; j < k; ++j) {
+        c = std::max({c, magnitude(octagon[j].x - origin.x), magnitude(octagon[j].y - origin.y)});
+    }
+    double ax[8], ay[8], ex[8], ey[8];
+    for (std::size_t j = 0; j < k; ++j) {
+        const Point &a = octagon[j];
+        const Point &b = octagon[(j + 1) % k];
+        ax[j] = (double)(a.x - origin.x);
+        ay[j] = (double)(a.y - origin.y);
+        ex[j] = (double)(b.x - a.x);
+        ey[j] = (double)(b.y - a.y);
+    }
+    // every point strictly inside lies within c of the origin, so only those are converted
+    const double bound = (double)c * (double)c * 0x1p-46;
+    alignas(32) double x[HULL_FILTER_CHUNK];
+    alignas(32) double y[HULL_FILTER_CHUNK];
+    uint64_t inside[HULL_FILTER_CHUNK / 64];
+    for (std::size_t start = 0; start < n; start += HULL_FILTER_CHUNK) {
+        std::size_t size = std::min(HULL_FILTER_CHUNK, n - start);
+        std::size_t padded = (size + 3) & ~(std::size_t)3;
+        const Point *chunk = first + start;
+        // points outside the bounding box become NaN, which fails every comparison and is kept
+        for (std::size_t i = 0; i < size; ++i) {
+            int64_t dx = chunk[i].x - origin.x, dy = chunk[i].y - origin.y;
+            bool near = magnitude(dx) <= c && magnitude(dy) <= c;
+            x[i] = near ? (double)dx : nan;
+            y[i] = near ? (double)dy : nan;
+        }
+        for (std::size_t i = size; i < padded; ++i) {
+            x[i] = nan;
+            y[i] = nan;
+        }
+        std::fill(inside, inside + HULL_FILTER_CHUNK / 64, 0);
+        hull_filter_kernel(x, y, padded, ax, ay, ex, ey, k, bound, inside);
+        for (std::size_t i = 0; i < size; ++i) {
+            if (!((inside[i / 64] >> (i % 64)) & 1)) {
+                first[kept++] = chunk[i];
+            }
+        }
+    }
+#else
+    for (std::size_t i = 0; i < n; ++i) {
+        bool inside = true;
+        for (std::size_t j = 0; j < k && inside; ++j) {
+            inside = ccw(octagon[j], octagon[(j + 1) % k], first[i]) > 0;
+        }
+        if (!inside) {
+            first[kept++] = first[i];
+        }
+    }
+#endif
+    return kept;
+}
+
+/**
+ * Graham scan in place: reorder [first, last) so that the hull is first[0 .. h - 1] and return h
+ * The hull starts at the lowest (then leftmost) point and runs counter-clockwise,
+ * collinear and duplicate points are not part of it
+ * Points inside the Akl-Toussaint octagon are dropped first, so usually only a few are sorted
+ * O(n log n) time, no allocation
+ */
+inline std::size_t convex_hull_inplace(Point *first, Point *last) {
+    std::size_t n = last - first;
+    if (n == 0) {
+        return 0;
+    }
+    if (n >= HULL_FILTER_CUTOFF) {
+        n = akl_toussaint_filter(first, last);
+        last = first + n;
+    }
+    std::swap(first[0], *std::min_element(first, last, hull_start_less));
+    const Point p0 = first[0];
+    // copies of p0 have no angle, drop them before sorting
+    std::size_t m = 1;
+    for (std::size_t i = 1; i < n; ++i) {
+        if (first[i] != p0) {
+            first[m++] = first[i];
+        }
+    }
+    // every other point is above p0 or right of it on the same row, so the angles span less than pi
+    // and the orientation is a strict weak order, the nearer point comes first on a ray
+    pdq_sort(first + 1, first + m, [p0](const Point &a, const Point &b) {
+        int turn = ccw(p0, a, b);
+        if (turn != 0) {
+            return turn > 0;
+        }
+        return ray_distance(p0, a) < ray_distance(p0, b);
+    });
+    // keep only the farthest point of every ray, which also drops duplicates
+    std::size_t k = 1;
+    for (std::size_t i = 1; i < m; ++i) {
+        if (i + 1 < m && ccw(p0, first[i], first[i + 1]) == 0) {
+            continue;
+        }
+        first[k++] = first[i];
+    }
+    // the hull is built in the prefix, it never grows past the point being read
+    std::size_t h = 1;
+    for (std::size_t i = 1; i < k; ++i) {
+        while (h > 1 && ccw(first[h - 2], first[h - 1], first[i]) <= 0) {
+            h--;
+        }
+        first[h++] = first[i];
+    }
+    return h;
+}
+
+/*
+ * Chan's algorithm
+ */
+
+/**
+ * The vertex of the strictly convex counter-clockwise polygon hull[0..k-1] that is the next hull vertex
+ * after p in a counter-clockwise gift wrap: no vertex lies right of p -> result
+ * Binary search for the tangent from p (Dan Sunday's tangent_PointPolyC), checked against both neighbours
+ * and redone by a linear scan when p is collinear with an edge or is a vertex of the polygon
+ */
+inline std::size_t chan_tangent(const Point *hull, std::size_t k, const Point &p) {
+    // r is a better wrap than q: right of p -> q, or on that ray and farther
+    auto better = [&p](const Point &q, const Point &r) {
+        int turn = ccw(p, q, r);
+        return q == p || (r != p && (turn < 0 || (turn == 0 && ray_distance(p, r) > ray_distance(p, q))));
+    };
+    auto linear = [&]() {
+        std::size_t best = 0;
+        for (std::size_t i = 1; i < k; ++i) {
+            if (better(hull[best], hull[i])) {
+                best = i;
+            }
+        }
+        return best;
+    };
+    if (k <= CHAN_LINEAR_TANGENT) {
+        return linear();
+    }
+    auto at = [hull, k](std::size_t i) -> const Point & { return hull[i % k]; };
+    // above(a, b): b is left of p -> a
+    auto above = [&p](const Point &a, const Point &b) { return ccw(p, a, b) > 0; };
+    auto below = [&p](const Point &a, const Point &b) { return ccw(p, a, b) < 0; };
+    std::size_t c = 0;
+    bool found = below(at(1), at(0)) && !above(at(k - 1), at(0));
+    std::size_t a = 0;
+    std::size_t b = k;
+    while (!found && b - a > 1) {
+        c = (a + b) / 2;
+        bool down_c = below(at(c + 1), at(c));
+        if (down_c && !above(at(c - 1), at(c))) {
+            found = true;
+        }
+        else if (above(at(a + 1), at(a))) {
+            // edge a points up
+            if (down_c || above(at(a), at(c))) {
+                b = c;
+            }
+            else {
+                a = c;
+            }
+        }
+        else {
+            // edge a points down
+            if (!down_c || !below(at(a), at(c))) {
+                a = c;
+            }
+            else {
+                b = c;
+            }
+        }
+    }
+    // the neighbours of a tangent vertex are not right of p -> hull[c]
+    if (hull[c] == p || ccw(p, hull[c], at(c + 1)) < 0 || ccw(p, hull[c], at(c + k - 1)) < 0) {
+        return linear();
+    }
+    if (ccw(p, hull[c], at(c + 1)) == 0 && better(hull[c], at(c + 1))) {
+        return (c + 1) % k;
+    }
+    if (ccw(p, hull[c], at(c + k - 1)) == 0 && better(hull[c], at(c + k - 1))) {
+        return (c + k - 1) % k;
+    }
+    return c;
+}
+
+/**
+ * Chan's algorithm: hull groups of m points with Graham scan, then gift-wrap at most m steps
+ * picking the best tangent of every group hull, O(n log m) per round
+ * m is squared after every round that did not close the hull, so the total is O(n log h)
+ */
+inline std::vector<Point> convex_hull_chan(const Point *first, const Point *last) {
+    std::size_t n = last - first;
+    std::vector<Point> hull;
+    if (n == 0) {
+        return hull;
+    }
+    std::size_t start_index = std::min_element(first, last, hull_start_less) - first;
+    const Point start = first[start_index];
+    std::vector<Point> work;
+    std::vector<std::size_t> group_begin;
+    std::vector<std::size_t> group_size;
+    for (std::size_t m = std::min(CHAN_INITIAL_GROUP, n);; m = m >= n / m ? n : m * m) {
+        work.assign(first, last);
+        group_begin.clear();
+        group_size.clear();
+        for (std::size_t g = 0; g < n; g += m) {
+            std::size_t size = std::min(m, n - g);
+            group_begin.push_back(g);
+            group_size.push_back(convex_hull_inplace(work.data() + g, work.data() + g + size));
+        }
+        // the current point is a vertex of the hull of its own group, where the next vertex is known
+        // without a tangent search, and Graham scan puts the start point first in its group
+        std::size_t current_group = start_index / m;
+        std::size_t current_index = 0;
+        hull.assign(1, start);
+        Point p = start;
+        bool closed = false;
+        for (std::size_t step = 0; step < m && !closed; ++step) {
+            bool found = false;
+            Point best = p;
+            std::size_t best_group = 0;
+            std::size_t best_index = 0;
+            for (std::size_t g = 0; g < group_begin.size(); ++g) {
+                const Point *group = work.data() + group_begin[g];
+                std::size_t index = g == current_group ? (current_index + 1) % group_size[g]
+                                                       : chan_tangent(group, group_size[g], p);
+                const Point &q = group[index];
+                if (q == p) {
+                    continue;
+                }
+                int turn = found ? ccw(p, best, q) : -1;
+                if (turn < 0 || (turn == 0 && ray_distance(p, q) > ray_distance(p, best))) {
+                    best = q;
+                    best_group = g;
+                    best_index = index;
+                    found = true;
+                }
+            }
+            if (!found || best == start) {
+                closed = true;
+            }
+            else {
+                hull.push_back(best);
+                p = best;
+                current_group = best_group;
+                current_index = best_index;
+            }
+        }
+        if (closed) {
+            return hull;
+        }
+    }
+}
+
+/*
+ * Parallel monotone chain (Andrew)
+ */
+
+inline bool point_less(const Point &a, const Point &b) {
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+// lower (sign 1) or upper (sign -1) chain of the sorted distinct points [first, last), left to right
+inline void monotone_chain(const Point *first, const Point *last, int sign, std::vector<Point> &chain) {
+    chain.clear();
+    for (const Point *p = first; p != last; ++p) {
+        while (chain.size() > 1 && ccw(chain[chain.size() - 2], chain.back(), *p) * sign <= 0) {
+            chain.pop_back();
+        }
+        chain.push_back(*p);
+    }
+}
+
+/**
+ * Append the chain right to the chain left, both lower (sign 1) or upper (sign -1) chains of point sets
+ * separated in point_less order, by walking to the bridge: the common tangent, in O(|left| + |right|)
+ */
+inline void merge_chains(std::vector<Point> &left, const std::vector<Point> &right, int sign) {
+    std::size_t i = left.size() - 1;
+    std::size_t j = 0;
+    bool moved = true;
+    while (moved) {
+        moved = false;
+        while (i > 0 && ccw(left[i - 1], left[i], right[j]) * sign <= 0) {
+            i--;
+            moved = true;
+        }
+        while (j + 1 < right.size() && ccw(left[i], right[j], right[j + 1]) * sign <= 0) {
+            j++;
+            moved = true;
+        }
+    }
+    left.resize(i + 1);
+    left.insert(left.end(), right.begin() + j, right.end());
+}
+
+/**
+ * Andrew's monotone chain on threads threads: sample_sort by (x, y), then every thread builds the lower
+ * and upper chains of one slice, and the slices are merged left to right at their bridges
+ * @param threads number of threads including the caller, 0 means hardware concurrency
+ */
+inline std::vector<Point> convex_hull_monotone_chain(const Point *first, const Point *last, unsigned threads = 0) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    std::vector<Point> points(first, last);
+    if (points.empty()) {
+        return points;
+    }
+    sample_sort(points.begin(), points.end(), point_less, std::max(threads, 1u));
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    std::size_t n = points.size();
+    std::size_t slices = n < HULL_PARALLEL_CUTOFF || threads <= 1 ? 1 : threads;
+    std::size_t slice_size = (n + slices - 1) / slices;
+    slices = (n + slice_size - 1) / slice_size;
+    std::vector<std::vector<Point> > lower(slices);
+    std::vector<std::vector<Point> > upper(slices);
+    auto build = [&](std::size_t s) {
+        const Point *begin = points.data() + s * slice_size;
+        const Point *end = points.data() + std::min(n, (s + 1) * slice_size);
+        monotone_chain(begin, end, 1, lower[s]);
+        monotone_chain(begin, end, -1, upper[s]);
+    };
+    if (slices == 1) {
+        build(0);
+    }
+    else {
+        // the calling thread joins the work while waiting
+        WorkStealingPool pool(threads - 1);
+        TaskGroup group(pool);
+        for (std::size_t s = 0; s < slices; ++s) {
+            group.run([&build, s]() { build(s); });
+        }
+        group.wait();
+    }
+    for (std::size_t s = 1; s < slices; ++s) {
+        merge_chains(lower[0], lower[s], 1);
+        merge_chains(upper[0], upper[s], -1);
+    }
+    // counter-clockwise: the lower chain, then the upper chain backwards without its ends
+    std::vector<Point> hull(lower[0]);
+    for (std::size_t i = upper[0].size() - 1; i-- > 1;) {
+        hull.push_back(upper[0][i]);
+    }
+    std::rotate(hull.begin(), std::min_element(hull.begin(), hull.end(), hull_start_less), hull.end());
+    return hull;
+}
+
+/**
+ * The convex hull of [first, last), counter-clockwise from the lowest (then leftmost) point,
+ * without collinear or duplicate points. Every algorithm gives the same result.
+ * The input is not modified
+ * @param threads used by HullAlgorithm::MonotoneChain, 0 means hardware concurrency
+ */
+inline std::vector<Point> convex_hull(const Point *first, const Point *last,
+                                      HullAlgorithm algorithm = HullAlgorithm::Graham, unsigned threads = 0) {
+    switch (algorithm) {
+        case HullAlgorithm::Chan:
+            return convex_hull_chan(first, last);
+        case HullAlgorithm::MonotoneChain:
+            return convex_hull_monotone_chain(first, last, threads);
+        default: {
+            std::vector<Point> hull(first, last);
+            hull.resize(convex_hull_inplace(hull.data(), hull.data() + hull.size()));
+            return hull;
+        }
+    }
+}
+
+inline std::vector<Point> convex_hull(const std::vector<Point> &points,
+                                      HullAlgorithm algorithm = HullAlgorithm::Graham, unsigned threads = 0) {
+    return convex_hull(points.data(), points.data() + points.size(), algorithm, threads);
+}
+
+#if __cplusplus >= 202002L
+inline std::vector<Point> convex_hull(std::span<const Point> points,
+                                      HullAlgorithm algorithm = HullAlgorithm::Graham, unsigned threads = 0) {
+    return convex_hull(points.data(), points.data() + points.size(), algorithm, threads);
+}
+#endif
+
+#endif //VE281P1_CONVEX_HULL_HPP
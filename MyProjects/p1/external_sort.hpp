@@ -0,0 +1,417 @@
+#ifndef VE281P1_EXTERNAL_SORT_HPP
+#define VE281P1_EXTERNAL_SORT_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "sort.hpp"
+
+/**
+ * Tuning knobs of external_sort
+ * Run formation holds about memoryBudget bytes (the chunk plus the merge buffer of the in-memory sort),
+ * a merge pass holds 2 * (fanIn + 1) * blockSize bytes of I/O buffers
+ */
+struct ExternalSortConfig {
+    size_t memoryBudget = (size_t)256 << 20;    // bytes used to sort one chunk in memory
+    size_t fanIn = 64;                          // maximum number of runs merged at once
+    size_t blockSize = (size_t)1 << 20;         // bytes per I/O buffer, every stream has two
+    std::string tempDirectory = ".";            // where the sorted runs are written
+};
+
+/**
+ * What external_sort did, for the I/O benchmark
+ */
+struct ExternalSortStats {
+    size_t elements = 0;
+    size_t runs = 0;                // number of runs after run formation
+    size_t mergePasses = 0;         // number of passes over the data after run formation
+    size_t bytesRead = 0;
+    size_t bytesWritten = 0;
+    double runSeconds = 0;          // time spent forming runs
+    double mergeSeconds = 0;        // time spent merging runs
+};
+
+/**
+ * Read a binary file of T sequentially with two buffers,
+ * the next block is read in the background while the current one is consumed
+ * @throw std::runtime_error from the constructor and pop() if a read fails
+ */
+template<typename T>
+class BlockReader {
+public:
+    BlockReader(const std::string &path, size_t blockElements) : buffers{std::vector<T>(blockElements), std::vector<T>(blockElements)} {
+        file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        pending = readAsync(0);
+        try {
+            advance();
+        }
+        catch (...) {
+            std::fclose(file);
+            throw;
+        }
+    }
+
+    BlockReader(const BlockReader&) = delete;
+
+    BlockReader& operator=(const BlockReader&) = delete;
+
+    ~BlockReader() {
+        if (pending.valid()) {
+            pending.wait();
+        }
+        std::fclose(file);
+    }
+
+    bool empty() const { return pos == count; }
+
+    const T& front() const { return buffers[current][pos]; }
+
+    void pop() {
+        if (++pos == count) {
+            advance();
+        }
+    }
+
+    size_t bytesRead() const { return totalRead * sizeof(T); }
+
+private:
+    std::FILE *file;
+    std::vector<T> buffers[2];
+    std::future<size_t> pending;    // read into buffers[current ^ 1]
+    int current = 1;
+    size_t pos = 0;
+    size_t count = 0;
+    size_t totalRead = 0;
+
+    std::future<size_t> readAsync(int index) {
+        std::FILE *f = file;
+        T *data = buffers[index].data();
+        size_t n = buffers[index].size();
+        return std::async(std::launch::async, [f, data, n]() { return std::fread(data, sizeof(T), n, f); });
+    }
+
+    void advance() {
+        if (!pending.valid()) {
+            return;
+        }
+        count = pending.get();
+        pos = 0;
+        totalRead += count;
+        current ^= 1;
+        // a short read is the end of the file unless the stream reports an error
+        if (count < buffers[current].size() && std::ferror(file)) {
+            count = 0;
+            throw std::runtime_error("read failed");
+        }
+        if (count == buffers[current].size()) {
+            pending = readAsync(current ^ 1);
+        }
+    }
+};
+
+/**
+ * Write a binary file of T sequentially with two buffers,
+ * a full block is written in the background while the other one is filled
+ */
+template<typename T>
+class BlockWriter {
+public:
+    BlockWriter(const std::string &path, size_t blockElements) : buffers{std::vector<T>(blockElements), std::vector<T>(blockElements)} {
+        file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("cannot open " + path);
+        }
+    }
+
+    BlockWriter(const BlockWriter&) = delete;
+
+    BlockWriter& operator=(const BlockWriter&) = delete;
+
+    ~BlockWriter() {
+        if (file != nullptr) {
+            if (pending.valid()) {
+                pending.wait();
+            }
+            std::fclose(file);
+        }
+    }
+
+    void push(const T &value) {
+        buffers[current][count++] = value;
+        if (count == buffers[current].size()) {
+            flush();
+        }
+    }
+
+    /**
+     * Write what is left and close the file
+     * @throw std::runtime_error if any write failed
+     */
+    void close() {
+        flush();
+        wait();
+        bool failed = std::fclose(file) != 0;
+        file = nullptr;
+        if (failed) {
+            throw std::runtime_error("write failed");
+        }
+    }
+
+    size_t bytesWritten() const { return totalWritten * sizeof(T); }
+
+private:
+    std::FILE *file;
+    std::vector<T> buffers[2];
+    std::future<bool> pending;      // writes the other buffer
+    int current = 0;
+    size_t count = 0;
+    size_t totalWritten = 0;
+
+    void wait() {
+        if (pending.valid() && !pending.get()) {
+            throw std::runtime_error("write failed");
+        }
+    }
+
+    void flush() {
+        if (count == 0) {
+            return;
+        }
+        wait();
+        std::FILE *f = file;
+        const T *data = buffers[current].data();
+        size_t n = count;
+        pending = std::async(std::launch::async, [f, data, n]() { return std::fwrite(data, sizeof(T), n, f) == n; });
+        totalWritten += count;
+        current ^= 1;
+        count = 0;
+    }
+};
+
+/**
+ * Names of the temporary files of one external_sort, every file still listed is removed by the destructor,
+ * so the runs do not outlive a sort that throws
+ */
+class TemporaryFiles {
+public:
+    explicit TemporaryFiles(std::string prefix) : prefix(std::move(prefix)) {}
+
+    TemporaryFiles(const TemporaryFiles&) = delete;
+
+    TemporaryFiles& operator=(const TemporaryFiles&) = delete;
+
+    ~TemporaryFiles() {
+        for (auto &path : paths) {
+            std::remove(path.c_str());
+        }
+    }
+
+    // a new name, the file is created by the caller
+    std::string create() {
+        std::string path = prefix + std::to_string(created++) + ".run";
+        paths.insert(path);
+        return path;
+    }
+
+    void remove(const std::string &path) {
+        std::remove(path.c_str());
+        paths.erase(path);
+    }
+
+    // stop tracking a file that was renamed
+    void release(const std::string &path) { paths.erase(path); }
+
+private:
+    std::string prefix;
+    std::set<std::string> paths;
+    size_t created = 0;
+};
+
+/**
+ * A tournament tree of losers over k sorted streams
+ * tree[0] holds the index of the smallest front, every internal node the loser of its match,
+ * so replacing the winner replays only the log k matches on its path
+ * Ties go to the stream with the smaller index, which keeps the merge stable
+ */
+template<typename T, typename Compare = std::less<T> >
+class LoserTree {
+public:
+    LoserTree(std::vector<BlockReader<T>*> &sources, Compare comp = Compare()) :
+        sources(sources), comp(comp), k((int)sources.size()), tree(std::max(k, 1)) {
+        std::vector<int> winner(2 * k);
+        for (int i = 0; i < k; ++i) {
+            winner[k + i] = i;
+        }
+        for (int node = k - 1; node >= 1; --node) {
+            int a = winner[2 * node];
+            int b = winner[2 * node + 1];
+            winner[node] = beats(a, b) ? a : b;
+            tree[node] = beats(a, b) ? b : a;
+        }
+        tree[0] = k == 1 ? 0 : winner[1];
+    }
+
+    bool empty() const { return k == 0 || sources[tree[0]]->empty(); }
+
+    const T& top() const { return sources[tree[0]]->front(); }
+
+    void pop() {
+        int current = tree[0];
+        sources[current]->pop();
+        for (int node = (k + current) / 2; node >= 1; node /= 2) {
+            if (beats(tree[node], current)) {
+                std::swap(tree[node], current);
+            }
+        }
+        tree[0] = current;
+    }
+
+private:
+    std::vector<BlockReader<T>*> &sources;
+    Compare comp;
+    int k;
+    std::vector<int> tree;
+
+    // an exhausted stream loses every match
+    bool beats(int a, int b) const {
+        if (sources[a]->empty()) {
+            return false;
+        }
+        if (sources[b]->empty()) {
+            return true;
+        }
+        if (comp(sources[b]->front(), sources[a]->front())) {
+            return false;
+        }
+        if (comp(sources[a]->front(), sources[b]->front())) {
+            return true;
+        }
+        return a < b;
+    }
+};
+
+// merge the runs with a loser tree into output, return the number of bytes read
+template<typename T, typename Compare = std::less<T> >
+size_t merge_runs(const std::vector<std::string> &runs, BlockWriter<T> &output, size_t blockElements, Compare comp = Compare()) {
+    std::vector<BlockReader<T>*> readers;
+    size_t bytesRead = 0;
+    try {
+        for (auto &run : runs) {
+            readers.push_back(new BlockReader<T>(run, blockElements));
+        }
+        LoserTree<T, Compare> tree(readers, comp);
+        while (!tree.empty()) {
+            output.push(tree.top());
+            tree.pop();
+        }
+    }
+    catch (...) {
+        for (auto reader : readers) {
+            delete reader;
+        }
+        throw;
+    }
+    for (auto reader : readers) {
+        bytesRead += reader->bytesRead();
+        delete reader;
+    }
+    return bytesRead;
+}
+
+/**
+ * Sort a binary file of T into another file with bounded memory
+ * Chunks of the input are sorted in memory by merge_sort_bottom_up and written as runs,
+ * then at most fanIn runs at a time are merged with a loser tree until one is left
+ * Stable. The runs are removed when they are merged, or when the sort throws.
+ * @throw std::runtime_error if a file cannot be opened, read or written
+ * @throw std::invalid_argument if the configuration cannot hold a single element
+ */
+template<typename T, typename Compare = std::less<T> >
+ExternalSortStats external_sort(const std::string &input, const std::string &output,
+                                const ExternalSortConfig &config = ExternalSortConfig(), Compare comp = Compare()) {
+    static_assert(std::is_trivially_copyable<T>::value, "external_sort reads and writes raw bytes");
+    typedef std::chrono::steady_clock Clock;
+    size_t chunkElements = config.memoryBudget / (2 * sizeof(T));
+    size_t blockElements = config.blockSize / sizeof(T);
+    if (chunkElements == 0 || blockElements == 0 || config.fanIn < 2) {
+        throw std::invalid_argument("invalid external sort config");
+    }
+    ExternalSortStats stats;
+    TemporaryFiles temporary(config.tempDirectory + "/external_sort_" + std::to_string(std::random_device()()) + "_");
+
+    // run formation
+    auto start = Clock::now();
+    std::vector<std::string> runs;
+    {
+        BlockReader<T> reader(input, blockElements);
+        std::vector<T> chunk;
+        std::vector<T> buffer;
+        // the whole chunk at once, growing by push_back could take twice the budget; untouched pages cost nothing
+        chunk.reserve(chunkElements);
+        while (!reader.empty()) {
+            chunk.clear();
+            while (!reader.empty() && chunk.size() < chunkElements) {
+                chunk.push_back(reader.front());
+                reader.pop();
+            }
+            merge_sort_bottom_up(chunk, buffer, comp);
+            runs.push_back(temporary.create());
+            BlockWriter<T> writer(runs.back(), blockElements);
+            for (auto &value : chunk) {
+                writer.push(value);
+            }
+            writer.close();
+            stats.elements += chunk.size();
+            stats.bytesWritten += writer.bytesWritten();
+        }
+        stats.bytesRead += reader.bytesRead();
+    }
+    stats.runs = runs.size();
+    stats.runSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // merge passes, the last one writes the output
+    start = Clock::now();
+    if (runs.size() == 1 && std::rename(runs[0].c_str(), output.c_str()) == 0) {
+        temporary.release(runs[0]);
+        runs.clear();
+    }
+    else if (runs.empty()) {
+        BlockWriter<T> writer(output, 1);
+        writer.close();
+    }
+    bool last = runs.empty();
+    while (!last) {
+        std::vector<std::string> next;
+        last = runs.size() <= config.fanIn;
+        for (size_t i = 0; i < runs.size(); i += config.fanIn) {
+            std::vector<std::string> group(runs.begin() + i, runs.begin() + std::min(i + config.fanIn, runs.size()));
+            std::string target = last ? output : temporary.create();
+            BlockWriter<T> writer(target, blockElements);
+            stats.bytesRead += merge_runs(group, writer, blockElements, comp);
+            writer.close();
+            stats.bytesWritten += writer.bytesWritten();
+            for (auto &run : group) {
+                temporary.remove(run);
+            }
+            next.push_back(target);
+        }
+        runs.swap(next);
+        stats.mergePasses++;
+    }
+    stats.mergeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return stats;
+}
+
+#endif //VE281P1_EXTERNAL_SORT_HPP
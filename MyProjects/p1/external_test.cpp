@@ -0,0 +1,55 @@
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include "external_sort.hpp"
+using namespace std;
+
+// usage: external_test [elements] [memory MB] [fan-in] [block KB]
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? stoull(argv[1]) : (size_t)1 << 25;
+    ExternalSortConfig config;
+    if (argc > 2) {
+        config.memoryBudget = stoull(argv[2]) << 20;
+    }
+    if (argc > 3) {
+        config.fanIn = stoull(argv[3]);
+    }
+    if (argc > 4) {
+        config.blockSize = stoull(argv[4]) << 10;
+    }
+    string input = "external_test_input.bin";
+    string output = "external_test_output.bin";
+    {
+        mt19937_64 rng(281);
+        BlockWriter<uint64_t> writer(input, config.blockSize / sizeof(uint64_t));
+        for (size_t i = 0; i < n; ++i) {
+            writer.push(rng());
+        }
+        writer.close();
+    }
+    ExternalSortStats stats = external_sort<uint64_t>(input, output, config);
+    bool sorted = true;
+    size_t count = 0;
+    {
+        BlockReader<uint64_t> reader(output, config.blockSize / sizeof(uint64_t));
+        uint64_t previous = 0;
+        for (; !reader.empty(); reader.pop(), ++count) {
+            if (reader.front() < previous) {
+                sorted = false;
+            }
+            previous = reader.front();
+        }
+    }
+    double mb = (double)(n * sizeof(uint64_t)) / (1 << 20);
+    double seconds = stats.runSeconds + stats.mergeSeconds;
+    cout << "elements " << n << " runs " << stats.runs << " merge passes " << stats.mergePasses << endl;
+    cout << "run formation " << stats.runSeconds << " s, merge " << stats.mergeSeconds << " s" << endl;
+    cout << "read " << (double)stats.bytesRead / (1 << 20) << " MB, written " << (double)stats.bytesWritten / (1 << 20) << " MB" << endl;
+    cout << "throughput " << mb / seconds << " MB/s, I/O " << (double)(stats.bytesRead + stats.bytesWritten) / (1 << 20) / seconds << " MB/s" << endl;
+    cout << (sorted && count == n ? "sorted" : "NOT SORTED") << endl;
+    remove(input.c_str());
+    remove(output.c_str());
+    return sorted && count == n ? 0 : 1;
+}
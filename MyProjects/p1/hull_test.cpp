@@ -0,0 +1,81 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "convex_hull.hpp"
+#include "incremental_hull.hpp"
+using namespace std;
+
+// points of one distribution: square has O(log n) hull vertices, disk O(n^(1/3)), circle all of them
+vector<Point> generate(const string &distribution, size_t n, mt19937_64 &rng) {
+    const double pi = 3.14159265358979323846;
+    uniform_real_distribution<double> uniform(0, 1);
+    vector<Point> points(n);
+    for (auto &p : points) {
+        if (distribution == "circle") {
+            double a = 2 * pi * uniform(rng);
+            p = Point{(int64_t)llround(1e9 * cos(a)), (int64_t)llround(1e9 * sin(a))};
+        }
+        else if (distribution == "disk") {
+            double a = 2 * pi * uniform(rng);
+            double r = 1e9 * sqrt(uniform(rng));
+            p = Point{(int64_t)llround(r * cos(a)), (int64_t)llround(r * sin(a))};
+        }
+        else {
+            p = Point{(int64_t)(rng() % 2000000001) - 1000000000, (int64_t)(rng() % 2000000001) - 1000000000};
+        }
+    }
+    return points;
+}
+
+// usage: hull_test [points] [threads]
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? stoull(argv[1]) : (size_t)1 << 24;
+    unsigned threads = argc > 2 ? (unsigned)stoul(argv[2]) : 0;
+    mt19937_64 rng(281);
+    bool same = true;
+    for (string distribution : {"square", "disk", "circle"}) {
+        vector<Point> points = generate(distribution, n, rng);
+        vector<Point> reference;
+        for (auto algorithm : {HullAlgorithm::Graham, HullAlgorithm::Chan, HullAlgorithm::MonotoneChain}) {
+            auto start = chrono::steady_clock::now();
+            vector<Point> hull = convex_hull(points, algorithm, threads);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            const char *name = algorithm == HullAlgorithm::Graham ? "graham" :
+                               algorithm == HullAlgorithm::Chan ? "chan" : "monotone_chain";
+            if (algorithm == HullAlgorithm::Graham) {
+                reference = hull;
+            }
+            same = same && hull == reference;
+            cout << distribution << " " << n << " " << name << " " << ms << " ms, " << hull.size() << " vertices"
+                 << (hull == reference ? "" : " DIFFERENT") << endl;
+        }
+        // streaming: the hull after every batch, recomputed from scratch or kept by IncrementalHull
+        const size_t batches = 16;
+        double recompute_ms = 0, incremental_ms = 0;
+        vector<Point> accumulated;
+        IncrementalHull incremental;
+        for (size_t b = 0; b < batches; ++b) {
+            const Point *first = points.data() + n * b / batches, *last = points.data() + n * (b + 1) / batches;
+            auto start = chrono::steady_clock::now();
+            accumulated.insert(accumulated.end(), first, last);
+            vector<Point> hull = convex_hull(accumulated);
+            auto middle = chrono::steady_clock::now();
+            incremental.insert(first, last);
+            vector<Point> current = incremental.hull();
+            auto end = chrono::steady_clock::now();
+            recompute_ms += chrono::duration<double, milli>(middle - start).count();
+            incremental_ms += chrono::duration<double, milli>(end - middle).count();
+            same = same && current == hull;
+            if (current != hull) {
+                cout << distribution << " " << n << " incremental batch " << b << " DIFFERENT" << endl;
+            }
+        }
+        cout << distribution << " " << n << " " << batches << " batches: recompute " << recompute_ms
+             << " ms, incremental " << incremental_ms << " ms" << endl;
+    }
+    return same ? 0 : 1;
+}
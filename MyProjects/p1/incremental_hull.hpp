@@ -0,0 +1,227 @@
+#ifndef VE281P1_INCREMENTAL_HULL_HPP
+#define VE281P1_INCREMENTAL_HULL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <vector>
+#include "convex_hull.hpp"
+
+/**
+ * One monotone chain of an IncrementalHull: the lower (sign 1) or upper (sign -1) hull of every point
+ * inserted, as a balanced tree from x to the lowest (lower) or highest (upper) y of the chain at that x
+ * Consecutive vertices turn strictly counter-clockwise (lower) or clockwise (upper) from left to right
+ */
+class HullChain {
+public:
+    explicit HullChain(int sign) : sign(sign) {}
+
+    /**
+     * Whether p is on the chain or on its inner side, so that inserting it changes nothing
+     * Time Complexity: O(log h)
+     */
+    bool covers(const Point &p) const {
+        auto next = chain.lower_bound(p.x);
+        if (next == chain.end()) {
+            return false;
+        }
+        if (next->first == p.x) {
+            return sign > 0 ? p.y >= next->second : p.y <= next->second;
+        }
+        if (next == chain.begin()) {
+            return false;
+        }
+        return ccw(point(std::prev(next)), point(next), p) * sign >= 0;
+    }
+
+    /**
+     * Add p, which covers() must have rejected, and erase the vertices it hides on both sides
+     * Time Complexity: O(log h) amortized, every vertex is erased at most once
+     */
+    void insert(const Point &p) {
+        auto it = chain.insert_or_assign(p.x, p.y).first;
+        while (it != chain.begin()) {
+            auto b = std::prev(it);
+            if (b == chain.begin() || ccw(point(std::prev(b)), point(b), p) * sign > 0) {
+                break;
+            }
+            chain.erase(b);
+        }
+        while (true) {
+            auto b = std::next(it);
+            if (b == chain.end() || std::next(b) == chain.end() || ccw(p, point(b), point(std::next(b))) * sign > 0) {
+                break;
+            }
+            chain.erase(b);
+        }
+    }
+
+    /**
+     * Replace the chain by the vertices of a monotone_chain of the same sign, left to right
+     * Time Complexity: O(h), every vertex is placed at the end of the tree
+     */
+    void assign(const std::vector<Point> &vertices) {
+        chain.clear();
+        for (const Point &p : vertices) {
+            // only the end columns can hold two vertices, keep the one with the outer y
+            if (!chain.empty() && std::prev(chain.end())->first == p.x) {
+                if (sign < 0) {
+                    std::prev(chain.end())->second = p.y;
+                }
+                continue;
+            }
+            chain.emplace_hint(chain.end(), p.x, p.y);
+        }
+    }
+
+    std::size_t size() const { return chain.size(); }
+
+    bool empty() const { return chain.empty(); }
+
+    Point front() const { return point(chain.begin()); }
+
+    Point back() const { return point(std::prev(chain.end())); }
+
+    void clear() { chain.clear(); }
+
+    std::map<int64_t, int64_t>::const_iterator begin() const { return chain.begin(); }
+
+    std::map<int64_t, int64_t>::const_iterator end() const { return chain.end(); }
+
+    static Point point(std::map<int64_t, int64_t>::const_iterator it) { return Point{it->first, it->second}; }
+
+private:
+    int sign;
+    std::map<int64_t, int64_t> chain;
+};
+
+/**
+ * Convex hull of a growing point set, kept up to date on every insertion
+ * The lower and upper chains are ordered trees, so a point already inside is rejected in O(log h)
+ * and any other point costs O(log h) amortized. hull() lists the current vertices without recomputing them
+ */
+class IncrementalHull {
+public:
+    IncrementalHull() = default;
+
+    /**
+     * Whether p is inside the current hull or on its boundary
+     * Time Complexity: O(log h)
+     */
+    bool contains(const Point &p) const {
+        return lower.covers(p) && upper.covers(p);
+    }
+
+    /**
+     * Add one point
+     * Time Complexity: O(log h) amortized
+     * @return false if p was already inside the hull, which is then unchanged
+     */
+    bool insert(const Point &p) {
+        bool inserted = false;
+        if (!lower.covers(p)) {
+            lower.insert(p);
+            inserted = true;
+        }
+        if (!upper.covers(p)) {
+            upper.insert(p);
+            inserted = true;
+        }
+        return inserted;
+    }
+
+    /**
+     * Add a batch of points
+     * Points inside the current hull are rejected first. When more remain than the hull has vertices,
+     * they are hulled together with the vertices by convex_hull_inplace and both chains are rebuilt in O(h log h),
+     * otherwise they are inserted one by one
+     * Time Complexity: O(m log h + k log k) for m points of which k are outside the hull
+     * @return the number of points that were outside the hull
+     */
+    std::size_t insert(const Point *first, const Point *last) {
+        std::vector<Point> outside;
+        for (const Point *p = first; p != last; ++p) {
+            if (!contains(*p)) {
+                outside.push_back(*p);
+            }
+        }
+        std::size_t count = outside.size();
+        if (count <= size()) {
+            for (const Point &p : outside) {
+                insert(p);
+            }
+            return count;
+        }
+        std::vector<Point> vertices = hull();
+        outside.insert(outside.end(), vertices.begin(), vertices.end());
+        outside.resize(convex_hull_inplace(outside.data(), outside.data() + outside.size()));
+        pdq_sort(outside.begin(), outside.end(), point_less);
+        monotone_chain(outside.data(), outside.data() + outside.size(), 1, vertices);
+        lower.assign(vertices);
+        monotone_chain(outside.data(), outside.data() + outside.size(), -1, vertices);
+        upper.assign(vertices);
+        return count;
+    }
+
+    std::size_t insert(const std::vector<Point> &points) {
+        return insert(points.data(), points.data() + points.size());
+    }
+
+    /**
+     * Number of hull vertices
+     * Time Complexity: O(1)
+     */
+    std::size_t size() const {
+        if (lower.empty()) {
+            return 0;
+        }
+        // a single column of points has one vertex in each chain
+        if (lower.size() == 1) {
+            return lower.front() == upper.front() ? 1 : 2;
+        }
+        return lower.size() + upper.size() - (lower.front() == upper.front()) - (lower.back() == upper.back());
+    }
+
+    bool empty() const { return lower.empty(); }
+
+    void clear() {
+        lower.clear();
+        upper.clear();
+    }
+
+    /**
+     * The current hull in the order of convex_hull: counter-clockwise from the lowest (then leftmost) point,
+     * without collinear or duplicate points
+     * Time Complexity: O(h)
+     */
+    std::vector<Point> hull() const {
+        std::vector<Point> result;
+        result.reserve(size());
+        if (lower.empty()) {
+            return result;
+        }
+        for (auto it = lower.begin(); it != lower.end(); ++it) {
+            result.push_back(HullChain::point(it));
+        }
+        // the upper chain right to left, without the end points both chains share
+        for (auto it = std::prev(upper.end()); ; --it) {
+            Point p = HullChain::point(it);
+            if (p != lower.back() && p != lower.front()) {
+                result.push_back(p);
+            }
+            if (it == upper.begin()) {
+                break;
+            }
+        }
+        std::rotate(result.begin(), std::min_element(result.begin(), result.end(), hull_start_less), result.end());
+        return result;
+    }
+
+private:
+    HullChain lower{1};
+    HullChain upper{-1};
+};
+
+#endif //VE281P1_INCREMENTAL_HULL_HPP
@@ -0,0 +1,323 @@
+#ifndef VE281P1_INSTRUMENTATION_HPP
+#define VE281P1_INSTRUMENTATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#if defined(SORT_INSTRUMENTATION) && defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define SORT_INSTRUMENTATION_PERF
+#endif
+
+#if defined(SORT_INSTRUMENTATION) && defined(SORT_INSTRUMENTATION_TRACK_ALLOCATIONS)
+#include <cstdlib>
+#include <new>
+#endif
+
+/*
+ * Instrumentation for the sorts in sort.hpp
+ * Build with -DSORT_INSTRUMENTATION to count comparisons, copies, moves and allocations,
+ * and on Linux to read hardware counters around every measured run.
+ * Without it every hook is an empty inline function and the wrappers are plain forwarding types,
+ * so instrumented call sites compile to the same code as uninstrumented ones.
+ * Allocation tracking replaces the global operator new and delete, so it is only compiled into the
+ * one translation unit that defines SORT_INSTRUMENTATION_TRACK_ALLOCATIONS before including this header.
+ */
+
+/**
+ * Event counts of one measured run
+ * The perf counters are -1 when they are not available (not Linux, or perf_event_open is not permitted)
+ */
+struct SortCounters {
+    uint64_t comparisons = 0;
+    uint64_t copies = 0;            // copy constructions and copy assignments of Counted elements
+    uint64_t moves = 0;             // move constructions and move assignments of Counted elements
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    int64_t cycles = -1;
+    int64_t branchMisses = -1;
+    int64_t cacheMisses = -1;       // last level cache misses
+    double milliseconds = 0;
+};
+
+namespace instrumentation {
+
+#if defined(SORT_INSTRUMENTATION)
+
+    // relaxed atomics, the parallel sorts count from several threads
+    struct Counters {
+        std::atomic<uint64_t> comparisons{0};
+        std::atomic<uint64_t> copies{0};
+        std::atomic<uint64_t> moves{0};
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> allocatedBytes{0};
+    };
+
+    inline Counters &counters() {
+        static Counters counters;
+        return counters;
+    }
+
+    inline void countComparison() { counters().comparisons.fetch_add(1, std::memory_order_relaxed); }
+
+    inline void countCopy() { counters().copies.fetch_add(1, std::memory_order_relaxed); }
+
+    inline void countMove() { counters().moves.fetch_add(1, std::memory_order_relaxed); }
+
+    inline void countAllocation(std::size_t bytes) {
+        counters().allocations.fetch_add(1, std::memory_order_relaxed);
+        counters().allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    inline void reset() {
+        counters().comparisons = 0;
+        counters().copies = 0;
+        counters().moves = 0;
+        counters().allocations = 0;
+        counters().allocatedBytes = 0;
+    }
+
+    inline void snapshot(SortCounters &result) {
+        result.comparisons = counters().comparisons.load();
+        result.copies = counters().copies.load();
+        result.moves = counters().moves.load();
+        result.allocations = counters().allocations.load();
+        result.allocatedBytes = counters().allocatedBytes.load();
+    }
+
+#else
+
+    inline void countComparison() {}
+
+    inline void countCopy() {}
+
+    inline void countMove() {}
+
+    inline void countAllocation(std::size_t) {}
+
+    inline void reset() {}
+
+    inline void snapshot(SortCounters &) {}
+
+#endif
+
+}
+
+/**
+ * Hardware counters (cycles, branch misses, last level cache misses) as one perf event group
+ * The events are inherited, so they also count the threads the calling thread starts after the counters are opened,
+ * such as the pools of the parallel sorts; a thread's counts are added to the totals when it exits
+ * Opening fails quietly when the kernel does not allow it, available() then returns false
+ */
+class PerfCounters {
+public:
+    PerfCounters() {
+#if defined(SORT_INSTRUMENTATION_PERF)
+        leader = open(PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (leader >= 0) {
+            branchMisses = open(PERF_COUNT_HW_BRANCH_MISSES, leader);
+            cacheMisses = open(PERF_COUNT_HW_CACHE_MISSES, leader);
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#if defined(SORT_INSTRUMENTATION_PERF)
+        for (int fd : {cacheMisses, branchMisses, leader}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const {
+#if defined(SORT_INSTRUMENTATION_PERF)
+        return leader >= 0;
+#else
+        return false;
+#endif
+    }
+
+    void start() {
+#if defined(SORT_INSTRUMENTATION_PERF)
+        if (leader >= 0) {
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    // stop counting and store the counts into result
+    void stop(SortCounters &result) {
+#if defined(SORT_INSTRUMENTATION_PERF)
+        if (leader < 0) {
+            return;
+        }
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        result.cycles = value(leader);
+        result.branchMisses = value(branchMisses);
+        result.cacheMisses = value(cacheMisses);
+#else
+        (void)result;
+#endif
+    }
+
+private:
+#if defined(SORT_INSTRUMENTATION_PERF)
+    int leader = -1;
+    int branchMisses = -1;
+    int cacheMisses = -1;
+
+    static int open(uint64_t config, int group) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = group < 0 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // inherited events cannot be read as a group (PERF_FORMAT_GROUP), so every event is read on its own
+        attr.inherit = 1;
+        return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+    }
+
+    // the count of one event, or -1 if it is not open or cannot be read
+    static int64_t value(int fd) {
+        uint64_t count = 0;
+        if (fd < 0 || read(fd, &count, sizeof(count)) != (ssize_t)sizeof(count)) {
+            return -1;
+        }
+        return (int64_t)count;
+    }
+#endif
+};
+
+/**
+ * Comparator wrapper counting every call of comp
+ */
+template<typename Compare>
+struct CountingCompare {
+    Compare comp;
+
+    CountingCompare(Compare comp = Compare()) : comp(comp) {}
+
+    template<typename A, typename B>
+    bool operator()(const A &a, const B &b) const {
+        instrumentation::countComparison();
+        return comp(a, b);
+    }
+};
+
+/**
+ * Element wrapper counting copies and moves, compared through the operators of T
+ * Without SORT_INSTRUMENTATION the special members are defaulted, so a trivially copyable T stays trivially copyable
+ */
+template<typename T>
+struct Counted {
+    T value;
+
+    Counted() = default;
+
+    Counted(const T &value) : value(value) {}
+
+#if defined(SORT_INSTRUMENTATION)
+    Counted(const Counted &other) : value(other.value) { instrumentation::countCopy(); }
+
+    Counted(Counted &&other) noexcept : value(std::move(other.value)) { instrumentation::countMove(); }
+
+    Counted& operator=(const Counted &other) {
+        instrumentation::countCopy();
+        value = other.value;
+        return *this;
+    }
+
+    Counted& operator=(Counted &&other) noexcept {
+        instrumentation::countMove();
+        value = std::move(other.value);
+        return *this;
+    }
+#endif
+
+    bool operator<(const Counted &other) const { return value < other.value; }
+
+    bool operator>(const Counted &other) const { return other.value < value; }
+
+    bool operator==(const Counted &other) const { return value == other.value; }
+
+    bool operator!=(const Counted &other) const { return !(value == other.value); }
+};
+
+/**
+ * Run f once and return its wall-clock time and, with SORT_INSTRUMENTATION, its event counts
+ */
+template<typename F>
+SortCounters measure(F f) {
+    SortCounters result;
+    PerfCounters perf;
+    instrumentation::reset();
+    auto start = std::chrono::steady_clock::now();
+    perf.start();
+    f();
+    perf.stop(result);
+    auto end = std::chrono::steady_clock::now();
+    instrumentation::snapshot(result);
+    result.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+    return result;
+}
+
+#if defined(SORT_INSTRUMENTATION) && defined(SORT_INSTRUMENTATION_TRACK_ALLOCATIONS)
+
+namespace instrumentation {
+
+    // out of line, otherwise GCC sees free() inlined into delete and warns that it does not match operator new
+#if defined(__GNUC__)
+    __attribute__((noinline))
+#endif
+    inline void release(void *p) noexcept { std::free(p); }
+
+}
+
+void *operator new(std::size_t size) {
+    instrumentation::countAllocation(size);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    instrumentation::release(p);
+}
+
+void operator delete[](void *p) noexcept {
+    instrumentation::release(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    instrumentation::release(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    instrumentation::release(p);
+}
+
+#endif
+
+#endif //VE281P1_INSTRUMENTATION_HPP
@@ -0,0 +1,313 @@
+#ifndef VE281P1_POINT_IO_HPP
+#define VE281P1_POINT_IO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "convex_hull.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define POINT_IO_POSIX
+#endif
+
+/*
+ * Bulk input and output of point sets for p1
+ * Text input is the point count followed by that many "x y" pairs separated by any whitespace.
+ * Binary input is POINT_FILE_MAGIC, the point count as uint64_t, then x and y of every point as int64_t,
+ * all in the byte order of the machine. Either is recognised from the first bytes.
+ */
+
+static constexpr char POINT_FILE_MAGIC[8] = {'V', 'E', '2', '8', '1', 'P', 'T', 'S'};
+// every coordinate must be smaller in magnitude, see Point in convex_hull.hpp
+static constexpr uint64_t POINT_COORDINATE_LIMIT = (uint64_t)1 << 62;
+// bytes per read() when the input cannot be mapped (a pipe or a terminal)
+static constexpr std::size_t POINT_READ_BLOCK = (std::size_t)1 << 20;
+
+/**
+ * The whole content of a file or of stdin as one contiguous range
+ * A regular file is mapped read-only, anything else is read in POINT_READ_BLOCK blocks
+ */
+class InputFile {
+public:
+    /**
+     * @param path the file to read, nullptr for stdin
+     * @throw std::runtime_error if the file cannot be opened or read
+     */
+    explicit InputFile(const char *path) {
+#if defined(POINT_IO_POSIX)
+        fd = path ? ::open(path, O_RDONLY) : 0;
+        if (fd < 0) {
+            throw std::runtime_error("cannot open " + std::string(path));
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void *map = mmap(nullptr, (std::size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                madvise(map, (std::size_t)info.st_size, MADV_SEQUENTIAL);
+                mapping = map;
+                data = (const char *)map;
+                size = (std::size_t)info.st_size;
+                return;
+            }
+        }
+        while (true) {
+            buffer.resize(size + POINT_READ_BLOCK);
+            ssize_t count = ::read(fd, buffer.data() + size, POINT_READ_BLOCK);
+            if (count < 0) {
+                close();
+                throw std::runtime_error("read failed");
+            }
+            if (count == 0) {
+                break;
+            }
+            size += (std::size_t)count;
+        }
+#else
+        file = path ? std::fopen(path, "rb") : stdin;
+        if (!file) {
+            throw std::runtime_error("cannot open " + std::string(path));
+        }
+        while (true) {
+            buffer.resize(size + POINT_READ_BLOCK);
+            std::size_t count = std::fread(buffer.data() + size, 1, POINT_READ_BLOCK, file);
+            size += count;
+            if (count < POINT_READ_BLOCK) {
+                break;
+            }
+        }
+#endif
+        data = buffer.data();
+    }
+
+    ~InputFile() { close(); }
+
+    InputFile(const InputFile&) = delete;
+
+    InputFile& operator=(const InputFile&) = delete;
+
+    const char *begin() const { return data; }
+
+    const char *end() const { return data + size; }
+
+private:
+    const char *data = nullptr;
+    std::size_t size = 0;
+    std::vector<char> buffer;
+#if defined(POINT_IO_POSIX)
+    int fd = -1;
+    void *mapping = nullptr;
+
+    void close() {
+        if (mapping) {
+            munmap(mapping, size);
+            mapping = nullptr;
+        }
+        if (fd > 0) {
+            ::close(fd);
+        }
+        fd = -1;
+    }
+#else
+    std::FILE *file = nullptr;
+
+    void close() {
+        if (file && file != stdin) {
+            std::fclose(file);
+        }
+        file = nullptr;
+    }
+#endif
+};
+
+/**
+ * The value of the len (1 to 8) decimal digits in the low bytes of the little-endian word, first digit lowest
+ * The digits are shifted to the top so the missing ones become leading zeros, then adjacent digits,
+ * pairs and quads are combined by three multiplications
+ */
+inline uint64_t parse_digits8(uint64_t word, unsigned len) {
+    word = (word - 0x3030303030303030ull) << (8 * (8 - len));
+    word = (word * 10 + (word >> 8)) & 0x00ff00ff00ff00ffull;
+    word = (word * 100 + (word >> 16)) & 0x0000ffff0000ffffull;
+    return (word * 10000 + (word >> 32)) & 0xffffffffull;
+}
+
+// the same whitespace as isspace in the C locale
+inline bool is_point_space(char c) {
+    return c == ' ' || (unsigned)(c - '\t') <= '\r' - '\t';
+}
+
+/**
+ * Parse one optionally negative decimal integer after any whitespace, it must end at whitespace or at end
+ * Eight bytes are classified and converted at a time while eight bytes remain before end
+ * @throw std::runtime_error if there is no integer before end, if it is followed by anything else
+ * or if its magnitude is not below POINT_COORDINATE_LIMIT
+ */
+inline int64_t parse_integer(const char *&pos, const char *end) {
+    while (pos < end && is_point_space(*pos)) {
+        ++pos;
+    }
+    bool negative = pos < end && *pos == '-';
+    pos += negative;
+    if (pos >= end || (unsigned)(*pos - '0') > 9) {
+        throw std::runtime_error("expected an integer");
+    }
+    static constexpr uint64_t powers[9] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+    // 19 digits cannot overflow uint64_t, the limit check below does the rest
+    static constexpr unsigned max_digits = 19;
+    uint64_t value = 0;
+    unsigned digits = 0;
+    bool more = true;
+    while (more && end - pos >= 8) {
+        uint64_t word;
+        std::memcpy(&word, pos, 8);
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        // a byte is a digit exactly when its high nibble is 3 before and after adding 6
+        uint64_t other = ((word & 0xf0f0f0f0f0f0f0f0ull) ^ 0x3030303030303030ull) |
+                         (((word + 0x0606060606060606ull) & 0xf0f0f0f0f0f0f0f0ull) ^ 0x3030303030303030ull);
+#if defined(__GNUC__)
+        unsigned len = other ? (unsigned)__builtin_ctzll(other) / 8 : 8;
+#else
+        unsigned len = 0;
+        while (len < 8 && !((other >> (8 * len)) & 0xff)) {
+            len++;
+        }
+#endif
+        digits += len;
+        if (digits > max_digits) {
+            throw std::runtime_error("integer out of range");
+        }
+        if (len > 0) {
+            value = value * powers[len] + parse_digits8(word, len);
+        }
+        pos += len;
+        more = len == 8;
+    }
+    while (pos < end && (unsigned)(*pos - '0') <= 9) {
+        if (++digits > max_digits) {
+            throw std::runtime_error("integer out of range");
+        }
+        value = value * 10 + (unsigned)(*pos++ - '0');
+    }
+    if (value >= POINT_COORDINATE_LIMIT) {
+        throw std::runtime_error("integer out of range");
+    }
+    if (pos < end && !is_point_space(*pos)) {
+        throw std::runtime_error("expected whitespace after an integer");
+    }
+    return negative ? -(int64_t)value : (int64_t)value;
+}
+
+/**
+ * The points of a text or binary point file in [begin, end), see the top of this file
+ * The point array is allocated once from the count in the header
+ * @throw std::runtime_error if the input is shorter than its count says or holds a coordinate out of range
+ */
+inline std::vector<Point> parse_points(const char *begin, const char *end) {
+    std::vector<Point> points;
+    std::size_t size = end - begin;
+    if (size >= sizeof(POINT_FILE_MAGIC) && std::memcmp(begin, POINT_FILE_MAGIC, sizeof(POINT_FILE_MAGIC)) == 0) {
+        uint64_t n = 0;
+        if (size >= sizeof(POINT_FILE_MAGIC) + sizeof(n)) {
+            std::memcpy(&n, begin + sizeof(POINT_FILE_MAGIC), sizeof(n));
+        }
+        std::size_t available = (size - std::min(size, sizeof(POINT_FILE_MAGIC) + sizeof(n))) / (2 * sizeof(int64_t));
+        if (n > available) {
+            throw std::runtime_error("binary point file is truncated");
+        }
+        points.resize(n);
+        std::memcpy(points.data(), begin + sizeof(POINT_FILE_MAGIC) + sizeof(n), n * sizeof(Point));
+        for (const Point &p : points) {
+            // 0 - x in unsigned arithmetic, as the magnitude of INT64_MIN does not fit in int64_t
+            if ((p.x < 0 ? 0 - (uint64_t)p.x : (uint64_t)p.x) >= POINT_COORDINATE_LIMIT ||
+                (p.y < 0 ? 0 - (uint64_t)p.y : (uint64_t)p.y) >= POINT_COORDINATE_LIMIT) {
+                throw std::runtime_error("coordinate out of range");
+            }
+        }
+        return points;
+    }
+    const char *pos = begin;
+    int64_t n = parse_integer(pos, end);
+    if (n <= 0) {
+        return points;
+    }
+    // every point takes at least four bytes, so a bad count cannot allocate more than the input
+    points.resize(std::min((std::size_t)n, size / 4 + 1));
+    if ((std::size_t)n > points.size()) {
+        throw std::runtime_error("expected " + std::to_string(n) + " points");
+    }
+    for (Point &p : points) {
+        p.x = parse_integer(pos, end);
+        p.y = parse_integer(pos, end);
+    }
+    return points;
+}
+
+/**
+ * Read a point file, or stdin if path is nullptr
+ * @throw std::runtime_error if it cannot be read or is malformed
+ */
+inline std::vector<Point> read_points(const char *path = nullptr) {
+    InputFile input(path);
+    return parse_points(input.begin(), input.end());
+}
+
+/**
+ * Write every point as "x y\n" into one buffer and hand it to file with a single fwrite
+ * @throw std::runtime_error if the write failed
+ */
+inline void write_points(const std::vector<Point> &points, std::FILE *file = stdout) {
+    // 20 characters and a sign per coordinate, one separator each
+    std::vector<char> buffer(points.size() * 44);
+    char *out = buffer.data();
+    auto put = [&out](int64_t v) {
+        uint64_t magnitude = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+        if (v < 0) {
+            *out++ = '-';
+        }
+        char digits[20];
+        int len = 0;
+        do {
+            digits[len++] = (char)('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude);
+        while (len) {
+            *out++ = digits[--len];
+        }
+    };
+    for (const Point &p : points) {
+        put(p.x);
+        *out++ = ' ';
+        put(p.y);
+        *out++ = '\n';
+    }
+    std::size_t size = out - buffer.data();
+    if (std::fwrite(buffer.data(), 1, size, file) != size || std::fflush(file) != 0) {
+        throw std::runtime_error("write failed");
+    }
+}
+
+/**
+ * Write the points in the binary point format
+ * @throw std::runtime_error if the write failed
+ */
+inline void write_points_binary(const std::vector<Point> &points, std::FILE *file = stdout) {
+    uint64_t n = points.size();
+    if (std::fwrite(POINT_FILE_MAGIC, 1, sizeof(POINT_FILE_MAGIC), file) != sizeof(POINT_FILE_MAGIC) ||
+        std::fwrite(&n, sizeof(n), 1, file) != 1 ||
+        std::fwrite(points.data(), sizeof(Point), points.size(), file) != points.size() ||
+        std::fflush(file) != 0) {
+        throw std::runtime_error("write failed");
+    }
+}
+
+#endif //VE281P1_POINT_IO_HPP
@@ -0,0 +1,228 @@
+#ifndef VE281P1_SMALL_SORT_HPP
+#define VE281P1_SMALL_SORT_HPP
+
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// longest range sort_network can sort
+static constexpr int SORT_NETWORK_MAX = 64;
+
+/**
+ * The vector operations used by the bitonic sorting network for one key type
+ * enabled is false when the type has no kernel or the target has no AVX2,
+ * callers then fall back to the scalar insertion sort
+ */
+template<typename T>
+struct SortNetworkTraits {
+    static constexpr bool enabled = false;
+};
+
+#if defined(__AVX2__)
+
+template<>
+struct SortNetworkTraits<int32_t> {
+    static constexpr bool enabled = true;
+    static constexpr int lanes = 8;
+    typedef __m256i Vec;
+
+    static Vec load(const int32_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+
+    static void store(int32_t *p, Vec v) { _mm256_storeu_si256((__m256i *)p, v); }
+
+    static Vec min(Vec a, Vec b) { return _mm256_min_epi32(a, b); }
+
+    static Vec max(Vec a, Vec b) { return _mm256_max_epi32(a, b); }
+
+    static Vec permute(Vec v, __m256i idx) { return _mm256_permutevar8x32_epi32(v, idx); }
+
+    static Vec blend(Vec a, Vec b, __m256i mask) { return _mm256_blendv_epi8(a, b, mask); }
+
+    static int32_t padding() { return std::numeric_limits<int32_t>::max(); }
+};
+
+template<>
+struct SortNetworkTraits<uint32_t> {
+    static constexpr bool enabled = true;
+    static constexpr int lanes = 8;
+    typedef __m256i Vec;
+
+    static Vec load(const uint32_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+
+    static void store(uint32_t *p, Vec v) { _mm256_storeu_si256((__m256i *)p, v); }
+
+    static Vec min(Vec a, Vec b) { return _mm256_min_epu32(a, b); }
+
+    static Vec max(Vec a, Vec b) { return _mm256_max_epu32(a, b); }
+
+    static Vec permute(Vec v, __m256i idx) { return _mm256_permutevar8x32_epi32(v, idx); }
+
+    static Vec blend(Vec a, Vec b, __m256i mask) { return _mm256_blendv_epi8(a, b, mask); }
+
+    static uint32_t padding() { return std::numeric_limits<uint32_t>::max(); }
+};
+
+// -0.0 and +0.0 compare equal and may come out in either order
+template<>
+struct SortNetworkTraits<float> {
+    static constexpr bool enabled = true;
+    static constexpr int lanes = 8;
+    typedef __m256 Vec;
+
+    static Vec load(const float *p) { return _mm256_loadu_ps(p); }
+
+    static void store(float *p, Vec v) { _mm256_storeu_ps(p, v); }
+
+    static Vec min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+
+    static Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+
+    static Vec permute(Vec v, __m256i idx) { return _mm256_permutevar8x32_ps(v, idx); }
+
+    static Vec blend(Vec a, Vec b, __m256i mask) { return _mm256_blendv_ps(a, b, _mm256_castsi256_ps(mask)); }
+
+    static float padding() { return std::numeric_limits<float>::infinity(); }
+};
+
+// AVX2 has no 64-bit min/max, so they are built from a signed compare,
+// unsigned keys get their sign bit flipped before comparing
+template<typename T>
+struct SortNetworkTraits64 {
+    static constexpr bool enabled = true;
+    static constexpr int lanes = 4;
+    typedef __m256i Vec;
+
+    static Vec load(const T *p) { return _mm256_loadu_si256((const __m256i *)p); }
+
+    static void store(T *p, Vec v) { _mm256_storeu_si256((__m256i *)p, v); }
+
+    static Vec greater(Vec a, Vec b) {
+        if (std::is_signed<T>::value) {
+            return _mm256_cmpgt_epi64(a, b);
+        }
+        const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+        return _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+    }
+
+    static Vec min(Vec a, Vec b) { return _mm256_blendv_epi8(a, b, greater(a, b)); }
+
+    static Vec max(Vec a, Vec b) { return _mm256_blendv_epi8(b, a, greater(a, b)); }
+
+    static Vec permute(Vec v, __m256i idx) { return _mm256_permutevar8x32_epi32(v, idx); }
+
+    static Vec blend(Vec a, Vec b, __m256i mask) { return _mm256_blendv_epi8(a, b, mask); }
+
+    static T padding() { return std::numeric_limits<T>::max(); }
+};
+
+template<>
+struct SortNetworkTraits<int64_t> : SortNetworkTraits64<int64_t> {};
+
+template<>
+struct SortNetworkTraits<uint64_t> : SortNetworkTraits64<uint64_t> {};
+
+/**
+ * Bitonic sort of R registers holding R * lanes keys in data
+ * Compare-exchanges between registers are plain min/max,
+ * inside a register the partner is fetched with a lane permute and the
+ * min or max is picked per lane with a blend
+ */
+template<typename T, int R>
+void bitonic_sort_registers(T *data) {
+    typedef SortNetworkTraits<T> Traits;
+    typedef typename Traits::Vec Vec;
+    constexpr int L = Traits::lanes;
+    constexpr int N = R * L;
+    constexpr int W = 8 / L;    // 32-bit words per lane
+    Vec v[R];
+    for (int r = 0; r < R; ++r) {
+        v[r] = Traits::load(data + r * L);
+    }
+    const __m256i word = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i lane = W == 1 ? word : _mm256_srli_epi32(word, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    for (int k = 2; k <= N; k <<= 1) {
+        for (int j = k >> 1; j > 0; j >>= 1) {
+            if (j >= L) {
+                int d = j / L;
+                for (int r = 0; r < R; ++r) {
+                    if ((r & d) == 0) {
+                        Vec lo = Traits::min(v[r], v[r + d]);
+                        Vec hi = Traits::max(v[r], v[r + d]);
+                        bool ascending = ((r * L) & k) == 0;
+                        v[r] = ascending ? lo : hi;
+                        v[r + d] = ascending ? hi : lo;
+                    }
+                }
+            }
+            else {
+                const __m256i idx = _mm256_xor_si256(word, _mm256_set1_epi32(j * W));
+                const __m256i step = _mm256_set1_epi32(j);
+                const __m256i upper = _mm256_cmpeq_epi32(_mm256_and_si256(lane, step), step);
+                for (int r = 0; r < R; ++r) {
+                    __m256i global = _mm256_add_epi32(lane, _mm256_set1_epi32(r * L));
+                    __m256i ascending = _mm256_cmpeq_epi32(_mm256_and_si256(global, _mm256_set1_epi32(k)), zero);
+                    // the upper lane of an ascending pair and the lower lane of a descending one take the max
+                    __m256i takeMax = _mm256_cmpeq_epi32(upper, ascending);
+                    Vec partner = Traits::permute(v[r], idx);
+                    v[r] = Traits::blend(Traits::min(v[r], partner), Traits::max(v[r], partner), takeMax);
+                }
+            }
+        }
+    }
+    for (int r = 0; r < R; ++r) {
+        Traits::store(data + r * L, v[r]);
+    }
+}
+
+template<typename T, int R>
+void bitonic_sort_dispatch(T *data, int registers) {
+    if constexpr (R * SortNetworkTraits<T>::lanes < SORT_NETWORK_MAX) {
+        if (registers > R) {
+            bitonic_sort_dispatch<T, R * 2>(data, registers);
+            return;
+        }
+    }
+    bitonic_sort_registers<T, R>(data);
+}
+
+#endif
+
+/**
+ * Sort data[0..n-1] (n <= SORT_NETWORK_MAX) in ascending order with a vectorized bitonic network
+ * The keys are copied into an aligned buffer and padded with the maximum value up to a power of two,
+ * so data need not be contiguous
+ * Only called when SortNetworkTraits<T>::enabled
+ */
+template<typename RandomIt>
+void sort_network(RandomIt data, int n) {
+#if defined(__AVX2__)
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    typedef SortNetworkTraits<T> Traits;
+    alignas(32) T buffer[SORT_NETWORK_MAX];
+    int size = Traits::lanes;
+    while (size < n) {
+        size <<= 1;
+    }
+    for (int i = 0; i < n; ++i) {
+        buffer[i] = data[i];
+    }
+    for (int i = n; i < size; ++i) {
+        buffer[i] = Traits::padding();
+    }
+    bitonic_sort_dispatch<T, 1>(buffer, size / Traits::lanes);
+    for (int i = 0; i < n; ++i) {
+        data[i] = buffer[i];
+    }
+#else
+    (void)data;
+    (void)n;
+#endif
+}
+
+#endif //VE281P1_SMALL_SORT_HPP
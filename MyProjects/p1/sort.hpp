@@ -2,178 +2,2040 @@
 #define VE281P1_SORT_HPP
 
 #include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <random>
+#include <utility>
+#include "small_sort.hpp"
+#include "thread_pool.hpp"
 
-template<typename T, typename Compare = std::less<T> >
-void bubble_sort(std::vector<T> &vector, Compare comp = Compare()) {
-    // TODO: implement
-    int size = (int)vector.size();
-    for (int i = 0; i < size - 1; ++i) {
-        for (int j = 0; j < size - 1 - i; ++j) {
-            if (comp(vector[j+1], vector[j])) {
-                T temp = vector[j + 1];
-                vector[j + 1] = vector[j];
-                vector[j] = temp;
+// ranges not longer than this are finished by insertion_sort_helper,
+// or by sort_network (up to SORT_NETWORK_MAX) for types it supports
+static constexpr int INSERTION_SORT_CUTOFF = 16;
+// ranges longer than this take the ninther instead of the median of three as pivot
+static constexpr int NINTHER_THRESHOLD = 128;
+
+// ranges shorter than this are sorted by merge_sort_helper on one thread
+static constexpr int MERGE_SORT_PARALLEL_CUTOFF = 1 << 13;
+// merges shorter than this are done by one thread
+static constexpr int MERGE_PARALLEL_CUTOFF = 1 << 14;
+
+// tim_sort: ranges shorter than this are one insertion-sorted run, and galloping starts after this many wins in a row
+static constexpr int TIM_SORT_MIN_MERGE = 32;
+static constexpr int TIM_SORT_MIN_GALLOP = 7;
+
+// pdq_sort: insertion sort cutoff, moves allowed to partial insertion sort, and the size of the offset blocks
+static constexpr int PDQ_INSERTION_SORT_CUTOFF = 24;
+static constexpr int PDQ_PARTIAL_INSERTION_SORT_LIMIT = 8;
+static constexpr int PDQ_BLOCK_SIZE = 64;
+
+// sample_sort: ranges not longer than this go to pdq_sort, otherwise they are split into
+// 2^SAMPLE_SORT_LOG_BUCKETS buckets by splitters picked from SAMPLE_SORT_OVERSAMPLING samples per bucket
+static constexpr int SAMPLE_SORT_CUTOFF = 1 << 16;
+static constexpr int SAMPLE_SORT_LOG_BUCKETS = 8;
+static constexpr int SAMPLE_SORT_BUCKETS = 1 << SAMPLE_SORT_LOG_BUCKETS;
+static constexpr int SAMPLE_SORT_OVERSAMPLING = 16;
+
+// radix sorts use 8-bit digits
+static constexpr int RADIX_BITS = 8;
+static constexpr int RADIX_BUCKETS = 1 << RADIX_BITS;
+// buckets not longer than this are finished by insertion_sort_helper in radix_sort_msd
+static constexpr int RADIX_SORT_MSD_CUTOFF = 64;
+
+/*
+ * Every sort takes a random-access iterator range [first, last) indexed by std::ptrdiff_t,
+ * so raw pointers into memory-mapped files or std::array can be sorted in place.
+ * The std::vector overloads are thin wrappers kept for existing callers.
+ * Helpers take the begin iterator and inclusive indices [l, r].
+ */
+
+template<typename RandomIt>
+using iterator_value_t = typename std::iterator_traits<RandomIt>::value_type;
+
+template<typename It, typename = void>
+struct is_random_access_iterator : std::false_type {};
+
+template<typename It>
+struct is_random_access_iterator<It, std::void_t<typename std::iterator_traits<It>::iterator_category> > :
+    std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category> {};
+
+// return type of the iterator overloads, keeps them away from the std::vector ones
+template<typename RandomIt>
+using enable_if_random_access_t = typename std::enable_if<is_random_access_iterator<RandomIt>::value>::type;
+
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> bubble_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    std::ptrdiff_t size = last - first;
+    for (std::ptrdiff_t i = 0; i < size - 1; ++i) {
+        for (std::ptrdiff_t j = 0; j < size - 1 - i; ++j) {
+            if (comp(first[j + 1], first[j])) {
+                std::swap(first[j + 1], first[j]);
             }
         }
     }
 }
 
 template<typename T, typename Compare = std::less<T> >
-void insertion_sort(std::vector<T> &vector, Compare comp = Compare()) {
+void bubble_sort(std::vector<T> &vector, Compare comp = Compare()) {
     // TODO: implement
-    int size = (int)vector.size();
-    int j;
-    T temp;
-    for (int i = 1; i < size;++i) {
+    bubble_sort(vector.begin(), vector.end(), comp);
+}
+
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+void insertion_sort_helper(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, Compare comp = Compare()) {
+    std::ptrdiff_t j;
+    iterator_value_t<RandomIt> temp;
+    for (std::ptrdiff_t i = l + 1; i <= r; ++i) {
         j = i - 1;
-        temp = vector[i];
-        while (j >= 0 && comp(temp,vector[j])) {
-            vector[j + 1] = vector[j];
+        temp = std::move(first[i]);
+        while (j >= l && comp(temp, first[j])) {
+            first[j + 1] = std::move(first[j]);
             j--;
         }
-        vector[j + 1] = temp;
+        first[j + 1] = std::move(temp);
     }
 }
 
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> insertion_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    insertion_sort_helper(first, 0, (last - first) - 1, comp);
+}
+
 template<typename T, typename Compare = std::less<T> >
-void selection_sort(std::vector<T> &vector, Compare comp = Compare()) {
+void insertion_sort(std::vector<T> &vector, Compare comp = Compare()) {
     // TODO: implement
-    int size = (int)vector.size();
-    int min_idx;
-    for (int i = 0; i < size - 1; ++i) {
+    insertion_sort(vector.begin(), vector.end(), comp);
+}
+
+// the sorting network sorts ascending keys only, it is not stable
+template<typename T, typename Compare>
+struct use_sort_network : std::integral_constant<bool,
+        SortNetworkTraits<T>::enabled && std::is_same<Compare, std::less<T> >::value> {};
+
+// equal integers are indistinguishable, so the network can serve stable sorts too
+template<typename T, typename Compare>
+struct use_stable_sort_network : std::integral_constant<bool,
+        use_sort_network<T, Compare>::value && std::is_integral<T>::value> {};
+
+template<typename T, typename Compare>
+constexpr int small_sort_cutoff() {
+    return use_sort_network<T, Compare>::value ? SORT_NETWORK_MAX : INSERTION_SORT_CUTOFF;
+}
+
+template<typename T, typename Compare>
+constexpr int stable_small_sort_cutoff() {
+    return use_stable_sort_network<T, Compare>::value ? SORT_NETWORK_MAX : INSERTION_SORT_CUTOFF;
+}
+
+// base case of the recursive sorts, for ranges not longer than small_sort_cutoff
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+void small_sort(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, Compare comp = Compare()) {
+    if constexpr (use_sort_network<iterator_value_t<RandomIt>, Compare>::value) {
+        if (l < r) {
+            sort_network(first + l, (int)(r - l + 1));
+        }
+    }
+    else {
+        insertion_sort_helper(first, l, r, comp);
+    }
+}
+
+// base case of the stable sorts, for ranges not longer than stable_small_sort_cutoff
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+void stable_small_sort(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, Compare comp = Compare()) {
+    if constexpr (use_stable_sort_network<iterator_value_t<RandomIt>, Compare>::value) {
+        if (l < r) {
+            sort_network(first + l, (int)(r - l + 1));
+        }
+    }
+    else {
+        insertion_sort_helper(first, l, r, comp);
+    }
+}
+
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> selection_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    std::ptrdiff_t size = last - first;
+    std::ptrdiff_t min_idx;
+    for (std::ptrdiff_t i = 0; i < size - 1; ++i) {
         min_idx = i;
-        for (int j = i + 1; j < size; ++j) {
-            if (comp(vector[j], vector[min_idx])) {
+        for (std::ptrdiff_t j = i + 1; j < size; ++j) {
+            if (comp(first[j], first[min_idx])) {
                 min_idx = j;
             }
         }
-        T temp = vector[min_idx];
-        vector[min_idx] = vector[i];
-        vector[i] = temp;
+        if (min_idx != i) {
+            std::swap(first[min_idx], first[i]);
+        }
     }
 }
 
 template<typename T, typename Compare = std::less<T> >
-void merge(std::vector<T> &vector, int l, int m, int r, Compare comp = Compare()) {
-    int i = l;
-    int j = m + 1;
-    int k = 0;
-    std::vector<T> temp(r - l + 1);
+void selection_sort(std::vector<T> &vector, Compare comp = Compare()) {
+    // TODO: implement
+    selection_sort(vector.begin(), vector.end(), comp);
+}
+
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+void merge(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t m, std::ptrdiff_t r, Compare comp = Compare()) {
+    std::ptrdiff_t i = l;
+    std::ptrdiff_t j = m + 1;
+    std::ptrdiff_t k = 0;
+    std::vector<iterator_value_t<RandomIt> > temp(r - l + 1);
     while (i <= m && j <= r) {
-        if (comp(vector[j], vector[i])) {
-            temp[k++] = vector[j++];
+        if (comp(first[j], first[i])) {
+            temp[k++] = std::move(first[j++]);
         }
         else {
-            temp[k++] = vector[i++];
+            temp[k++] = std::move(first[i++]);
         }
     }
     while (i <= m) {
-        temp[k++] = vector[i++];
+        temp[k++] = std::move(first[i++]);
     }
     while (j <= r) {
-        temp[k++] = vector[j++];
+        temp[k++] = std::move(first[j++]);
     }
-    for (int m = 0; m < k; ++m) {
-        vector[l + m] = temp[m];
+    for (std::ptrdiff_t m = 0; m < k; ++m) {
+        first[l + m] = std::move(temp[m]);
     }
 }
 
-template<typename T, typename Compare = std::less<T> >
-void merge_sort_helper(std::vector<T> &vector, int l, int r, Compare comp = Compare()) {
-    if (l >= r) {
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+void merge_sort_helper(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, Compare comp = Compare()) {
+    if (r - l + 1 <= stable_small_sort_cutoff<iterator_value_t<RandomIt>, Compare>()) {
+        stable_small_sort(first, l, r, comp);
         return;
     }
-    int m = l + (r - l) / 2;
-    merge_sort_helper(vector, l, m, comp);
-    merge_sort_helper(vector, m + 1, r, comp);
-    merge(vector, l, m, r, comp);
+    std::ptrdiff_t m = l + (r - l) / 2;
+    merge_sort_helper(first, l, m, comp);
+    merge_sort_helper(first, m + 1, r, comp);
+    merge(first, l, m, r, comp);
+}
+
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> merge_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    merge_sort_helper(first, 0, (last - first) - 1, comp);
 }
 
 template<typename T, typename Compare = std::less<T> >
 void merge_sort(std::vector<T> &vector, Compare comp = Compare()) {
     // TODO: implement
-    merge_sort_helper(vector, 0, (int)vector.size() - 1, comp);
+    merge_sort(vector.begin(), vector.end(), comp);
 }
 
-template<typename T, typename Compare = std::less<T> >
-int partition_extra(std::vector<T> &vector, int l, int r, Compare comp = Compare()) {
-    T pivot = vector[l];
-    std::vector<T> ex(vector);
-    int ll = l;
-    int rr = r;
-    for (int i = l + 1; i <= r; ++i) {
-        if (comp(vector[i], pivot)) {
-            ex[ll] = vector[i];
-            ll++;
+template<typename SrcIt, typename DstIt, typename Compare>
+void merge_move(SrcIt src, std::ptrdiff_t l1, std::ptrdiff_t r1, std::ptrdiff_t l2, std::ptrdiff_t r2,
+                DstIt dst, std::ptrdiff_t k, Compare comp) {
+    while (l1 <= r1 && l2 <= r2) {
+        if (comp(src[l2], src[l1])) {
+            dst[k++] = std::move(src[l2++]);
         }
         else {
-            ex[rr] = vector[i];
-            rr--;
+            dst[k++] = std::move(src[l1++]);
         }
     }
-    ex[ll] = pivot;
-    vector = ex;
-    return ll;
+    while (l1 <= r1) {
+        dst[k++] = std::move(src[l1++]);
+    }
+    while (l2 <= r2) {
+        dst[k++] = std::move(src[l2++]);
+    }
+}
+
+// merge src[l1..r1] and src[l2..r2] into dst[k..], splitting the larger run at its middle
+// and co-ranking the other one by binary search, so that the two halves merge in parallel
+template<typename SrcIt, typename DstIt, typename Compare>
+void merge_parallel(SrcIt src, std::ptrdiff_t l1, std::ptrdiff_t r1, std::ptrdiff_t l2, std::ptrdiff_t r2,
+                    DstIt dst, std::ptrdiff_t k, WorkStealingPool &pool, Compare comp) {
+    std::ptrdiff_t n1 = r1 - l1 + 1;
+    std::ptrdiff_t n2 = r2 - l2 + 1;
+    if (n1 + n2 <= MERGE_PARALLEL_CUTOFF) {
+        merge_move(src, l1, r1, l2, r2, dst, k, comp);
+        return;
+    }
+    std::ptrdiff_t m1, m2;
+    if (n1 >= n2) {
+        // right elements equal to the pivot stay behind it
+        m1 = l1 + (r1 - l1) / 2;
+        std::ptrdiff_t lo = l2;
+        std::ptrdiff_t hi = r2 + 1;
+        while (lo < hi) {
+            std::ptrdiff_t mid = lo + (hi - lo) / 2;
+            if (comp(src[mid], src[m1])) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        m2 = lo;
+        std::ptrdiff_t km = k + (m1 - l1) + (m2 - l2);
+        dst[km] = std::move(src[m1]);
+        TaskGroup group(pool);
+        group.run([&, l1, m1, l2, m2, k]() { merge_parallel(src, l1, m1 - 1, l2, m2 - 1, dst, k, pool, comp); });
+        merge_parallel(src, m1 + 1, r1, m2, r2, dst, km + 1, pool, comp);
+        group.wait();
+    }
+    else {
+        // left elements equal to the pivot stay in front of it
+        m2 = l2 + (r2 - l2) / 2;
+        std::ptrdiff_t lo = l1;
+        std::ptrdiff_t hi = r1 + 1;
+        while (lo < hi) {
+            std::ptrdiff_t mid = lo + (hi - lo) / 2;
+            if (comp(src[m2], src[mid])) {
+                hi = mid;
+            }
+            else {
+                lo = mid + 1;
+            }
+        }
+        m1 = lo;
+        std::ptrdiff_t km = k + (m1 - l1) + (m2 - l2);
+        dst[km] = std::move(src[m2]);
+        TaskGroup group(pool);
+        group.run([&, l1, m1, l2, m2, k]() { merge_parallel(src, l1, m1 - 1, l2, m2 - 1, dst, k, pool, comp); });
+        merge_parallel(src, m1, r1, m2 + 1, r2, dst, km + 1, pool, comp);
+        group.wait();
+    }
+}
+
+// sort first[l..r], leaving the result in buffer[l..r] if to_buffer, otherwise in first[l..r]
+template<typename RandomIt, typename BufferIt, typename Compare>
+void merge_sort_parallel_helper(RandomIt first, BufferIt buffer, std::ptrdiff_t l, std::ptrdiff_t r, bool to_buffer,
+                                WorkStealingPool &pool, Compare comp) {
+    if (r - l + 1 <= MERGE_SORT_PARALLEL_CUTOFF) {
+        merge_sort_helper(first, l, r, comp);
+        if (to_buffer) {
+            for (std::ptrdiff_t i = l; i <= r; ++i) {
+                buffer[i] = std::move(first[i]);
+            }
+        }
+        return;
+    }
+    std::ptrdiff_t m = l + (r - l) / 2;
+    TaskGroup group(pool);
+    group.run([&, l, m, to_buffer]() { merge_sort_parallel_helper(first, buffer, l, m, !to_buffer, pool, comp); });
+    merge_sort_parallel_helper(first, buffer, m + 1, r, !to_buffer, pool, comp);
+    group.wait();
+    if (to_buffer) {
+        merge_parallel(first, l, m, m + 1, r, buffer, l, pool, comp);
+    }
+    else {
+        merge_parallel(buffer, l, m, m + 1, r, first, l, pool, comp);
+    }
+}
+
+/**
+ * Stable parallel merge sort, gives the same output as merge_sort
+ * @param threads number of threads, 0 means hardware concurrency
+ */
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> merge_sort_parallel(RandomIt first, RandomIt last, Compare comp = Compare(),
+                                                        unsigned threads = 0) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (last - first <= MERGE_SORT_PARALLEL_CUTOFF || threads <= 1) {
+        merge_sort(first, last, comp);
+        return;
+    }
+    std::vector<iterator_value_t<RandomIt> > buffer(last - first);
+    // the calling thread joins the work while waiting
+    WorkStealingPool pool(threads - 1);
+    merge_sort_parallel_helper(first, buffer.begin(), 0, (last - first) - 1, false, pool, comp);
 }
 
 template<typename T, typename Compare = std::less<T> >
-void quick_sort_extra_helper(std::vector<T> &vector, int l, int r, Compare comp = Compare()) {
-    int pivot_idx;
-    if (l >= r) {
+void merge_sort_parallel(std::vector<T> &vector, Compare comp = Compare(), unsigned threads = 0) {
+    merge_sort_parallel(vector.begin(), vector.end(), comp, threads);
+}
+
+// merge the runs of length width in src[0..n-1] pairwise into dst,
+// adjacent runs that are already in order are moved without comparing
+template<typename SrcIt, typename DstIt, typename Compare>
+void merge_pass(SrcIt src, DstIt dst, std::ptrdiff_t n, std::ptrdiff_t width, Compare comp) {
+    for (std::ptrdiff_t l = 0; l < n; l += 2 * width) {
+        std::ptrdiff_t m = std::min(l + width, n) - 1;
+        std::ptrdiff_t r = std::min(l + 2 * width, n) - 1;
+        if (m >= r || !comp(src[m + 1], src[m])) {
+            for (std::ptrdiff_t i = l; i <= r; ++i) {
+                dst[i] = std::move(src[i]);
+            }
+        }
+        else {
+            merge_move(src, l, m, m + 1, r, dst, l, comp);
+        }
+    }
+}
+
+/**
+ * Iterative bottom-up merge sort using buffer as the only scratch space
+ * buffer is resized when it is shorter than the range, so it can be reused across calls
+ */
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> merge_sort_bottom_up(RandomIt first, RandomIt last,
+                                                         std::vector<iterator_value_t<RandomIt> > &buffer,
+                                                         Compare comp = Compare()) {
+    std::ptrdiff_t n = last - first;
+    const std::ptrdiff_t cutoff = stable_small_sort_cutoff<iterator_value_t<RandomIt>, Compare>();
+    for (std::ptrdiff_t l = 0; l < n; l += cutoff) {
+        stable_small_sort(first, l, std::min(l + cutoff, n) - 1, comp);
+    }
+    if (n <= cutoff) {
         return;
     }
-    pivot_idx = partition_extra(vector, l, r, comp);
-    quick_sort_extra_helper(vector, l, pivot_idx - 1, comp);
-    quick_sort_extra_helper(vector, pivot_idx + 1, r, comp);
+    if ((std::ptrdiff_t)buffer.size() < n) {
+        buffer.resize(n);
+    }
+    bool in_buffer = false;
+    for (std::ptrdiff_t width = cutoff; width < n; width *= 2) {
+        if (in_buffer) {
+            merge_pass(buffer.begin(), first, n, width, comp);
+        }
+        else {
+            merge_pass(first, buffer.begin(), n, width, comp);
+        }
+        in_buffer = !in_buffer;
+    }
+    if (in_buffer) {
+        std::move(buffer.begin(), buffer.begin() + n, first);
+    }
+}
+
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> merge_sort_bottom_up(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    std::vector<iterator_value_t<RandomIt> > buffer;
+    merge_sort_bottom_up(first, last, buffer, comp);
+}
+
+template<typename T, typename Compare = std::less<T> >
+void merge_sort_bottom_up(std::vector<T> &vector, std::vector<T> &buffer, Compare comp = Compare()) {
+    merge_sort_bottom_up(vector.begin(), vector.end(), buffer, comp);
+}
+
+template<typename T, typename Compare = std::less<T> >
+void merge_sort_bottom_up(std::vector<T> &vector, Compare comp = Compare()) {
+    merge_sort_bottom_up(vector.begin(), vector.end(), comp);
+}
+
+/**
+ * The state of one tim_sort call: the stack of pending runs, the merge buffer and the galloping threshold
+ * Runs on the stack keep len[i - 2] > len[i - 1] + len[i] and len[i - 1] > len[i],
+ * so the stack stays O(log n) deep and merges stay balanced
+ */
+template<typename RandomIt, typename Compare>
+class TimSort {
+public:
+    typedef iterator_value_t<RandomIt> T;
+
+    TimSort(RandomIt first, Compare comp) : first(first), comp(comp), minGallop(TIM_SORT_MIN_GALLOP) {}
+
+    void sort(std::ptrdiff_t n) {
+        if (n < 2) {
+            return;
+        }
+        if (n < TIM_SORT_MIN_MERGE) {
+            countRunAndMakeAscending(0, n);
+            insertion_sort_helper(first, 0, n - 1, comp);
+            return;
+        }
+        std::ptrdiff_t minRun = minRunLength(n);
+        std::ptrdiff_t lo = 0;
+        while (lo < n) {
+            std::ptrdiff_t runLen = countRunAndMakeAscending(lo, n);
+            if (runLen < minRun) {
+                // the run is a sorted prefix, so insertion sort only pays for the new elements
+                runLen = std::min(minRun, n - lo);
+                insertion_sort_helper(first, lo, lo + runLen - 1, comp);
+            }
+            runBase.push_back(lo);
+            runLength.push_back(runLen);
+            mergeCollapse();
+            lo += runLen;
+        }
+        while (runBase.size() > 1) {
+            std::ptrdiff_t i = (std::ptrdiff_t)runBase.size() - 2;
+            if (i > 0 && runLength[i - 1] < runLength[i + 1]) {
+                i--;
+            }
+            mergeAt(i);
+        }
+    }
+
+private:
+    RandomIt first;
+    Compare comp;
+    std::ptrdiff_t minGallop;
+    std::vector<std::ptrdiff_t> runBase;
+    std::vector<std::ptrdiff_t> runLength;
+    std::vector<T> tmp;
+
+    // n / 2^k rounded up so that it lies in [16, 32], which keeps n / minRun close to a power of two
+    static std::ptrdiff_t minRunLength(std::ptrdiff_t n) {
+        std::ptrdiff_t r = 0;
+        while (n >= TIM_SORT_MIN_MERGE) {
+            r |= n & 1;
+            n >>= 1;
+        }
+        return n + r;
+    }
+
+    // length of the run starting at lo, a strictly descending run is reversed in place
+    std::ptrdiff_t countRunAndMakeAscending(std::ptrdiff_t lo, std::ptrdiff_t hi) {
+        std::ptrdiff_t runHi = lo + 1;
+        if (runHi == hi) {
+            return 1;
+        }
+        if (comp(first[runHi++], first[lo])) {
+            while (runHi < hi && comp(first[runHi], first[runHi - 1])) {
+                runHi++;
+            }
+            std::reverse(first + lo, first + runHi);
+        }
+        else {
+            while (runHi < hi && !comp(first[runHi], first[runHi - 1])) {
+                runHi++;
+            }
+        }
+        return runHi - lo;
+    }
+
+    void mergeCollapse() {
+        while (runBase.size() > 1) {
+            std::ptrdiff_t n = (std::ptrdiff_t)runBase.size() - 2;
+            if ((n > 0 && runLength[n - 1] <= runLength[n] + runLength[n + 1]) ||
+                (n > 1 && runLength[n - 2] <= runLength[n] + runLength[n - 1])) {
+                if (runLength[n - 1] < runLength[n + 1]) {
+                    n--;
+                }
+            }
+            else if (runLength[n] > runLength[n + 1]) {
+                break;
+            }
+            mergeAt(n);
+        }
+    }
+
+    /**
+     * Galloping search for the leftmost position of key in a[base..base+len-1], starting at base+hint
+     * @return k such that a[base+k-1] < key <= a[base+k]
+     */
+    template<typename It>
+    std::ptrdiff_t gallopLeft(const T &key, It a, std::ptrdiff_t base, std::ptrdiff_t len, std::ptrdiff_t hint) {
+        std::ptrdiff_t lastOfs = 0;
+        std::ptrdiff_t ofs = 1;
+        if (comp(a[base + hint], key)) {
+            std::ptrdiff_t maxOfs = len - hint;
+            while (ofs < maxOfs && comp(a[base + hint + ofs], key)) {
+                lastOfs = ofs;
+                ofs = (ofs << 1) + 1;
+            }
+            ofs = std::min(ofs, maxOfs);
+            lastOfs += hint;
+            ofs += hint;
+        }
+        else {
+            std::ptrdiff_t maxOfs = hint + 1;
+            while (ofs < maxOfs && !comp(a[base + hint - ofs], key)) {
+                lastOfs = ofs;
+                ofs = (ofs << 1) + 1;
+            }
+            ofs = std::min(ofs, maxOfs);
+            std::ptrdiff_t temp = lastOfs;
+            lastOfs = hint - ofs;
+            ofs = hint - temp;
+        }
+        lastOfs++;
+        while (lastOfs < ofs) {
+            std::ptrdiff_t m = lastOfs + (ofs - lastOfs) / 2;
+            if (comp(a[base + m], key)) {
+                lastOfs = m + 1;
+            }
+            else {
+                ofs = m;
+            }
+        }
+        return ofs;
+    }
+
+    /**
+     * Galloping search for the rightmost position of key in a[base..base+len-1], starting at base+hint
+     * @return k such that a[base+k-1] <= key < a[base+k]
+     */
+    template<typename It>
+    std::ptrdiff_t gallopRight(const T &key, It a, std::ptrdiff_t base, std::ptrdiff_t len, std::ptrdiff_t hint) {
+        std::ptrdiff_t lastOfs = 0;
+        std::ptrdiff_t ofs = 1;
+        if (comp(key, a[base + hint])) {
+            std::ptrdiff_t maxOfs = hint + 1;
+            while (ofs < maxOfs && comp(key, a[base + hint - ofs])) {
+                lastOfs = ofs;
+                ofs = (ofs << 1) + 1;
+            }
+            ofs = std::min(ofs, maxOfs);
+            std::ptrdiff_t temp = lastOfs;
+            lastOfs = hint - ofs;
+            ofs = hint - temp;
+        }
+        else {
+            std::ptrdiff_t maxOfs = len - hint;
+            while (ofs < maxOfs && !comp(key, a[base + hint + ofs])) {
+                lastOfs = ofs;
+                ofs = (ofs << 1) + 1;
+            }
+            ofs = std::min(ofs, maxOfs);
+            lastOfs += hint;
+            ofs += hint;
+        }
+        lastOfs++;
+        while (lastOfs < ofs) {
+            std::ptrdiff_t m = lastOfs + (ofs - lastOfs) / 2;
+            if (comp(key, a[base + m])) {
+                ofs = m;
+            }
+            else {
+                lastOfs = m + 1;
+            }
+        }
+        return ofs;
+    }
+
+    // merge the runs i and i + 1 of the stack, i is the second or third run from the top
+    void mergeAt(std::ptrdiff_t i) {
+        std::ptrdiff_t base1 = runBase[i];
+        std::ptrdiff_t len1 = runLength[i];
+        std::ptrdiff_t base2 = runBase[i + 1];
+        std::ptrdiff_t len2 = runLength[i + 1];
+        runLength[i] = len1 + len2;
+        runBase.erase(runBase.begin() + i + 1);
+        runLength.erase(runLength.begin() + i + 1);
+        // elements of run1 before the first of run2, and of run2 after the last of run1, are in place
+        std::ptrdiff_t k = gallopRight(first[base2], first, base1, len1, 0);
+        base1 += k;
+        len1 -= k;
+        if (len1 == 0) {
+            return;
+        }
+        len2 = gallopLeft(first[base1 + len1 - 1], first, base2, len2, len2 - 1);
+        if (len2 == 0) {
+            return;
+        }
+        if (len1 <= len2) {
+            mergeLo(base1, len1, base2, len2);
+        }
+        else {
+            mergeHi(base1, len1, base2, len2);
+        }
+    }
+
+    // merge from the left with run1 moved to tmp, first[base1 + len1 - 1] > first[base2] > first[base1]
+    void mergeLo(std::ptrdiff_t base1, std::ptrdiff_t len1, std::ptrdiff_t base2, std::ptrdiff_t len2) {
+        if ((std::ptrdiff_t)tmp.size() < len1) {
+            tmp.resize(len1);
+        }
+        std::move(first + base1, first + base1 + len1, tmp.begin());
+        std::ptrdiff_t cursor1 = 0;
+        std::ptrdiff_t cursor2 = base2;
+        std::ptrdiff_t dest = base1;
+        first[dest++] = std::move(first[cursor2++]);
+        if (--len2 == 0) {
+            std::move(tmp.begin(), tmp.begin() + len1, first + dest);
+            return;
+        }
+        if (len1 == 1) {
+            std::move(first + cursor2, first + cursor2 + len2, first + dest);
+            first[dest + len2] = std::move(tmp[cursor1]);
+            return;
+        }
+        std::ptrdiff_t gallop = minGallop;
+        while (true) {
+            std::ptrdiff_t count1 = 0;
+            std::ptrdiff_t count2 = 0;
+            bool done = false;
+            // one pair at a time until a run wins gallop times in a row
+            do {
+                if (comp(first[cursor2], tmp[cursor1])) {
+                    first[dest++] = std::move(first[cursor2++]);
+                    count2++;
+                    count1 = 0;
+                    done = --len2 == 0;
+                }
+                else {
+                    first[dest++] = std::move(tmp[cursor1++]);
+                    count1++;
+                    count2 = 0;
+                    done = --len1 == 1;
+                }
+            } while (!done && std::max(count1, count2) < gallop);
+            // galloping: move whole blocks while they stay long
+            while (!done) {
+                count1 = gallopRight(first[cursor2], tmp, cursor1, len1, 0);
+                if (count1 != 0) {
+                    std::move(tmp.begin() + cursor1, tmp.begin() + cursor1 + count1, first + dest);
+                    dest += count1;
+                    cursor1 += count1;
+                    len1 -= count1;
+                    if (len1 <= 1) {
+                        break;
+                    }
+                }
+                first[dest++] = std::move(first[cursor2++]);
+                if (--len2 == 0) {
+                    break;
+                }
+                count2 = gallopLeft(tmp[cursor1], first, cursor2, len2, 0);
+                if (count2 != 0) {
+                    std::move(first + cursor2, first + cursor2 + count2, first + dest);
+                    dest += count2;
+                    cursor2 += count2;
+                    len2 -= count2;
+                    if (len2 == 0) {
+                        break;
+                    }
+                }
+                first[dest++] = std::move(tmp[cursor1++]);
+                if (--len1 == 1) {
+                    break;
+                }
+                gallop--;
+                if (count1 < TIM_SORT_MIN_GALLOP && count2 < TIM_SORT_MIN_GALLOP) {
+                    gallop = std::max(gallop, (std::ptrdiff_t)0) + 2;
+                    break;
+                }
+            }
+            if (len1 <= 1 || len2 == 0) {
+                break;
+            }
+        }
+        minGallop = std::max(gallop, (std::ptrdiff_t)1);
+        if (len1 == 1) {
+            std::move(first + cursor2, first + cursor2 + len2, first + dest);
+            first[dest + len2] = std::move(tmp[cursor1]);
+        }
+        else {
+            std::move(tmp.begin() + cursor1, tmp.begin() + cursor1 + len1, first + dest);
+        }
+    }
+
+    // merge from the right with run2 moved to tmp, first[base1 + len1 - 1] > first[base2 + len2 - 1] > first[base1]
+    void mergeHi(std::ptrdiff_t base1, std::ptrdiff_t len1, std::ptrdiff_t base2, std::ptrdiff_t len2) {
+        if ((std::ptrdiff_t)tmp.size() < len2) {
+            tmp.resize(len2);
+        }
+        std::move(first + base2, first + base2 + len2, tmp.begin());
+        std::ptrdiff_t cursor1 = base1 + len1 - 1;
+        std::ptrdiff_t cursor2 = len2 - 1;
+        std::ptrdiff_t dest = base2 + len2 - 1;
+        first[dest--] = std::move(first[cursor1--]);
+        if (--len1 == 0) {
+            std::move(tmp.begin(), tmp.begin() + len2, first + (dest - (len2 - 1)));
+            return;
+        }
+        if (len2 == 1) {
+            dest -= len1;
+            cursor1 -= len1;
+            std::move_backward(first + cursor1 + 1, first + cursor1 + 1 + len1, first + dest + 1 + len1);
+            first[dest] = std::move(tmp[cursor2]);
+            return;
+        }
+        std::ptrdiff_t gallop = minGallop;
+        while (true) {
+            std::ptrdiff_t count1 = 0;
+            std::ptrdiff_t count2 = 0;
+            bool done = false;
+            do {
+                if (comp(tmp[cursor2], first[cursor1])) {
+                    first[dest--] = std::move(first[cursor1--]);
+                    count1++;
+                    count2 = 0;
+                    done = --len1 == 0;
+                }
+                else {
+                    first[dest--] = std::move(tmp[cursor2--]);
+                    count2++;
+                    count1 = 0;
+                    done = --len2 == 1;
+                }
+            } while (!done && std::max(count1, count2) < gallop);
+            while (!done) {
+                count1 = len1 - gallopRight(tmp[cursor2], first, base1, len1, len1 - 1);
+                if (count1 != 0) {
+                    dest -= count1;
+                    cursor1 -= count1;
+                    len1 -= count1;
+                    std::move_backward(first + cursor1 + 1, first + cursor1 + 1 + count1, first + dest + 1 + count1);
+                    if (len1 == 0) {
+                        break;
+                    }
+                }
+                first[dest--] = std::move(tmp[cursor2--]);
+                if (--len2 == 1) {
+                    break;
+                }
+                count2 = len2 - gallopLeft(first[cursor1], tmp, 0, len2, len2 - 1);
+                if (count2 != 0) {
+                    dest -= count2;
+                    cursor2 -= count2;
+                    len2 -= count2;
+                    std::move(tmp.begin() + cursor2 + 1, tmp.begin() + cursor2 + 1 + count2, first + dest + 1);
+                    if (len2 <= 1) {
+                        break;
+                    }
+                }
+                first[dest--] = std::move(first[cursor1--]);
+                if (--len1 == 0) {
+                    break;
+                }
+                gallop--;
+                if (count1 < TIM_SORT_MIN_GALLOP && count2 < TIM_SORT_MIN_GALLOP) {
+                    gallop = std::max(gallop, (std::ptrdiff_t)0) + 2;
+                    break;
+                }
+            }
+            if (len1 == 0 || len2 <= 1) {
+                break;
+            }
+        }
+        minGallop = std::max(gallop, (std::ptrdiff_t)1);
+        if (len2 == 1) {
+            dest -= len1;
+            cursor1 -= len1;
+            std::move_backward(first + cursor1 + 1, first + cursor1 + 1 + len1, first + dest + 1 + len1);
+            first[dest] = std::move(tmp[cursor2]);
+        }
+        else {
+            std::move(tmp.begin(), tmp.begin() + len2, first + (dest - (len2 - 1)));
+        }
+    }
+};
+
+/**
+ * Adaptive stable merge sort (TimSort): natural runs are detected, descending ones reversed,
+ * short ones extended by insertion sort, and merges switch to galloping when one run keeps winning
+ * O(n) on sorted or reverse-sorted input, O(n log n) in the worst case
+ */
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> tim_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    TimSort<RandomIt, Compare>(first, comp).sort(last - first);
+}
+
+template<typename T, typename Compare = std::less<T> >
+void tim_sort(std::vector<T> &vector, Compare comp = Compare()) {
+    tim_sort(vector.begin(), vector.end(), comp);
+}
+
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+std::ptrdiff_t median_of_three(RandomIt first, std::ptrdiff_t a, std::ptrdiff_t b, std::ptrdiff_t c,
+                               Compare comp = Compare()) {
+    if (comp(first[a], first[b])) {
+        if (comp(first[b], first[c])) {
+            return b;
+        }
+        return comp(first[a], first[c]) ? c : a;
+    }
+    if (comp(first[a], first[c])) {
+        return a;
+    }
+    return comp(first[b], first[c]) ? c : b;
+}
+
+// move the median of three (or Tukey's ninther for long ranges) to first[l]
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+void choose_pivot(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, Compare comp = Compare()) {
+    std::ptrdiff_t m = l + (r - l) / 2;
+    std::ptrdiff_t pivot_idx;
+    if (r - l + 1 > NINTHER_THRESHOLD) {
+        std::ptrdiff_t step = (r - l + 1) / 8;
+        std::ptrdiff_t a = median_of_three(first, l, l + step, l + 2 * step, comp);
+        std::ptrdiff_t b = median_of_three(first, m - step, m, m + step, comp);
+        std::ptrdiff_t c = median_of_three(first, r - 2 * step, r - step, r, comp);
+        pivot_idx = median_of_three(first, a, b, c, comp);
+    }
+    else {
+        pivot_idx = median_of_three(first, l, m, r, comp);
+    }
+    if (pivot_idx != l) {
+        std::swap(first[l], first[pivot_idx]);
+    }
+}
+
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+void sift_down(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t i, std::ptrdiff_t n, Compare comp = Compare()) {
+    // heap of n elements rooted at first[l], i is relative to l
+    iterator_value_t<RandomIt> temp = std::move(first[l + i]);
+    while (2 * i + 1 < n) {
+        std::ptrdiff_t child = 2 * i + 1;
+        if (child + 1 < n && comp(first[l + child], first[l + child + 1])) {
+            child++;
+        }
+        if (!comp(temp, first[l + child])) {
+            break;
+        }
+        first[l + i] = std::move(first[l + child]);
+        i = child;
+    }
+    first[l + i] = std::move(temp);
+}
+
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+void heap_sort_helper(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, Compare comp = Compare()) {
+    std::ptrdiff_t n = r - l + 1;
+    for (std::ptrdiff_t i = n / 2 - 1; i >= 0; --i) {
+        sift_down(first, l, i, n, comp);
+    }
+    for (std::ptrdiff_t i = n - 1; i > 0; --i) {
+        std::swap(first[l], first[l + i]);
+        sift_down(first, l, 0, i, comp);
+    }
+}
+
+// 2 * floor(log2(n)), the number of partitions introsort allows before switching to heapsort
+inline int introsort_depth_limit(std::ptrdiff_t n) {
+    int depth_limit = 0;
+    for (; n > 1; n >>= 1) {
+        depth_limit += 2;
+    }
+    return depth_limit;
+}
+
+// partition src[l..r] around src[l] into dst[l..r], return the index of the pivot
+template<typename SrcIt, typename DstIt, typename Compare>
+std::ptrdiff_t partition_extra(SrcIt src, DstIt dst, std::ptrdiff_t l, std::ptrdiff_t r, Compare comp) {
+    std::ptrdiff_t ll = l;
+    std::ptrdiff_t rr = r;
+    for (std::ptrdiff_t i = l + 1; i <= r; ++i) {
+        if (comp(src[i], src[l])) {
+            dst[ll++] = std::move(src[i]);
+        }
+        else {
+            dst[rr--] = std::move(src[i]);
+        }
+    }
+    dst[ll] = std::move(src[l]);
+    return ll;
+}
+
+// first[l..r] lives in buffer if in_buffer, every partition moves it to the other side,
+// pivots and small ranges are written back to first where they are final
+template<typename RandomIt, typename BufferIt, typename Compare>
+void quick_sort_extra_helper(RandomIt first, BufferIt buffer, std::ptrdiff_t l, std::ptrdiff_t r, bool in_buffer,
+                             int depth_limit, Compare comp) {
+    const std::ptrdiff_t cutoff = small_sort_cutoff<iterator_value_t<RandomIt>, Compare>();
+    std::ptrdiff_t pivot_idx;
+    while (r - l + 1 > cutoff && depth_limit > 0) {
+        depth_limit--;
+        if (in_buffer) {
+            choose_pivot(buffer, l, r, comp);
+            pivot_idx = partition_extra(buffer, first, l, r, comp);
+        }
+        else {
+            choose_pivot(first, l, r, comp);
+            pivot_idx = partition_extra(first, buffer, l, r, comp);
+            first[pivot_idx] = std::move(buffer[pivot_idx]);
+        }
+        in_buffer = !in_buffer;
+        if (pivot_idx - l < r - pivot_idx) {
+            quick_sort_extra_helper(first, buffer, l, pivot_idx - 1, in_buffer, depth_limit, comp);
+            l = pivot_idx + 1;
+        }
+        else {
+            quick_sort_extra_helper(first, buffer, pivot_idx + 1, r, in_buffer, depth_limit, comp);
+            r = pivot_idx - 1;
+        }
+    }
+    if (in_buffer) {
+        for (std::ptrdiff_t i = l; i <= r; ++i) {
+            first[i] = std::move(buffer[i]);
+        }
+    }
+    if (r - l + 1 > cutoff) {
+        heap_sort_helper(first, l, r, comp);
+    }
+    else {
+        small_sort(first, l, r, comp);
+    }
+}
+
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> quick_sort_extra(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    std::vector<iterator_value_t<RandomIt> > buffer(last - first);
+    quick_sort_extra_helper(first, buffer.begin(), 0, (last - first) - 1, false,
+                            introsort_depth_limit(last - first), comp);
 }
 
 template<typename T, typename Compare = std::less<T> >
 void quick_sort_extra(std::vector<T> &vector, Compare comp = Compare()) {
     // TODO: implement
-    quick_sort_extra_helper(vector, 0, (int)vector.size() - 1, comp);
+    quick_sort_extra(vector.begin(), vector.end(), comp);
 }
 
-template<typename T, typename Compare = std::less<T> >
-int partition_inplace(std::vector<T> &vector,int l, int r, Compare comp = Compare()) {
-    T pivot = vector[l];
-    int ll = l + 1;
-    int rr = r;
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+std::ptrdiff_t partition_inplace(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, Compare comp = Compare()) {
+    // first[l] is not read again until the pivot goes back
+    iterator_value_t<RandomIt> pivot = std::move(first[l]);
+    std::ptrdiff_t ll = l + 1;
+    std::ptrdiff_t rr = r;
     while (true) {
-        while (comp(vector[ll], pivot) && ll <= r) {
+        while (ll <= r && comp(first[ll], pivot)) {
             ll++;
         }
-        while (!comp(vector[rr], pivot) && rr > l) {
+        while (rr > l && !comp(first[rr], pivot)) {
             rr--;
         }
         if (ll < rr) {
-            T temp = vector[ll];
-            vector[ll] = vector[rr];
-            vector[rr] = temp;
+            std::swap(first[ll], first[rr]);
         }
         else {
-            vector[l] = vector[rr];
-            vector[rr] = pivot;
+            if (rr != l) {
+                first[l] = std::move(first[rr]);
+            }
+            first[rr] = std::move(pivot);
             break;
         }
     }
     return rr;
 }
 
-template<typename T, typename Compare = std::less<T> >
-void quick_sort_inplace_helper(std::vector<T> &vector, int l, int r, Compare comp = Compare()) {
-    int pivot_idx;
-    if (l >= r) {
-        return;
+// introsort: recurse into the smaller side and loop on the larger one,
+// so the stack depth is O(log n), and fall back to heapsort after depth_limit partitions
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+void quick_sort_inplace_helper(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, int depth_limit,
+                               Compare comp = Compare()) {
+    std::ptrdiff_t pivot_idx;
+    while (r - l + 1 > small_sort_cutoff<iterator_value_t<RandomIt>, Compare>()) {
+        if (depth_limit == 0) {
+            heap_sort_helper(first, l, r, comp);
+            return;
+        }
+        depth_limit--;
+        choose_pivot(first, l, r, comp);
+        pivot_idx = partition_inplace(first, l, r, comp);
+        if (pivot_idx - l < r - pivot_idx) {
+            quick_sort_inplace_helper(first, l, pivot_idx - 1, depth_limit, comp);
+            l = pivot_idx + 1;
+        }
+        else {
+            quick_sort_inplace_helper(first, pivot_idx + 1, r, depth_limit, comp);
+            r = pivot_idx - 1;
+        }
     }
-    pivot_idx = partition_inplace(vector, l, r, comp);
-    quick_sort_inplace_helper(vector, l, pivot_idx - 1, comp);
-    quick_sort_inplace_helper(vector, pivot_idx + 1, r, comp);
+    small_sort(first, l, r, comp);
+}
+
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> quick_sort_inplace(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    quick_sort_inplace_helper(first, 0, (last - first) - 1, introsort_depth_limit(last - first), comp);
 }
 
 template<typename T, typename Compare = std::less<T> >
 void quick_sort_inplace(std::vector<T> &vector, Compare comp = Compare()) {
     // TODO: implement
-    quick_sort_inplace_helper(vector, 0, (int)vector.size() - 1, comp);
+    quick_sort_inplace(vector.begin(), vector.end(), comp);
+}
+
+/**
+ * Bentley-McIlroy 3-way partition of first[l..r] around first[l]
+ * Keys equal to the pivot are swapped to both ends while scanning and moved to the middle at the end
+ * @return the bounds lt, gt: first[l..lt - 1] < pivot, first[lt..gt] == pivot, first[gt + 1..r] > pivot
+ */
+template<typename RandomIt, typename Compare>
+std::pair<std::ptrdiff_t, std::ptrdiff_t> partition_3way(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r,
+                                                         Compare comp) {
+    // first[l] is the pivot and stays in place until the end, it is the first of the equal keys on the left
+    std::ptrdiff_t a = l + 1;
+    std::ptrdiff_t b = l + 1;
+    std::ptrdiff_t c = r;
+    std::ptrdiff_t d = r;
+    while (true) {
+        while (b <= c && !comp(first[l], first[b])) {
+            if (!comp(first[b], first[l])) {
+                std::swap(first[a++], first[b]);
+            }
+            b++;
+        }
+        while (c >= b && !comp(first[c], first[l])) {
+            if (!comp(first[l], first[c])) {
+                std::swap(first[c], first[d--]);
+            }
+            c--;
+        }
+        if (b > c) {
+            break;
+        }
+        std::swap(first[b++], first[c--]);
+    }
+    // equal [l, a) less [a, b) greater (c, d] equal (d, r]
+    std::ptrdiff_t s = std::min(a - l, b - a);
+    std::swap_ranges(first + l, first + (l + s), first + (b - s));
+    s = std::min(d - c, r - d);
+    std::swap_ranges(first + b, first + (b + s), first + (r - s + 1));
+    return std::make_pair(l + (b - a), r - (d - c));
+}
+
+// introsort on partition_3way, the keys equal to the pivot are final and never visited again
+template<typename RandomIt, typename Compare>
+void quick_sort_3way_helper(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, int depth_limit, Compare comp) {
+    while (r - l + 1 > small_sort_cutoff<iterator_value_t<RandomIt>, Compare>()) {
+        if (depth_limit == 0) {
+            heap_sort_helper(first, l, r, comp);
+            return;
+        }
+        depth_limit--;
+        choose_pivot(first, l, r, comp);
+        std::pair<std::ptrdiff_t, std::ptrdiff_t> equal = partition_3way(first, l, r, comp);
+        if (equal.first - l < r - equal.second) {
+            quick_sort_3way_helper(first, l, equal.first - 1, depth_limit, comp);
+            l = equal.second + 1;
+        }
+        else {
+            quick_sort_3way_helper(first, equal.second + 1, r, depth_limit, comp);
+            r = equal.first - 1;
+        }
+    }
+    small_sort(first, l, r, comp);
+}
+
+/**
+ * Quicksort with 3-way partitioning for inputs with many duplicate keys
+ * O(n log k) expected for k distinct keys, O(n log n) worst case. Not stable.
+ */
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> quick_sort_3way(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    quick_sort_3way_helper(first, 0, (last - first) - 1, introsort_depth_limit(last - first), comp);
+}
+
+template<typename T, typename Compare = std::less<T> >
+void quick_sort_3way(std::vector<T> &vector, Compare comp = Compare()) {
+    quick_sort_3way(vector.begin(), vector.end(), comp);
+}
+
+/*
+ * Selection: the k-th smallest element and the k smallest elements without sorting everything
+ */
+
+template<typename RandomIt, typename Compare>
+void quick_select_helper(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, std::ptrdiff_t k, bool median_of_medians,
+                         Compare comp);
+
+// move the median of the medians of groups of five to first[l],
+// at least 3/10 of first[l..r] is not greater and 3/10 not less than it
+template<typename RandomIt, typename Compare>
+void median_of_medians_pivot(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, Compare comp) {
+    std::ptrdiff_t count = 0;
+    for (std::ptrdiff_t g = l; g <= r; g += 5) {
+        std::ptrdiff_t gr = std::min(g + 4, r);
+        insertion_sort_helper(first, g, gr, comp);
+        std::swap(first[l + count], first[g + (gr - g) / 2]);
+        count++;
+    }
+    std::ptrdiff_t median = l + (count - 1) / 2;
+    quick_select_helper(first, l, l + count - 1, median, true, comp);
+    std::swap(first[l], first[median]);
+}
+
+// first[p] is the smallest of first[p..r], gather the elements equal to it right after it
+// and return the index past them
+template<typename RandomIt, typename Compare>
+std::ptrdiff_t partition_equal(RandomIt first, std::ptrdiff_t p, std::ptrdiff_t r, Compare comp) {
+    std::ptrdiff_t next = p + 1;
+    for (std::ptrdiff_t i = p + 1; i <= r; ++i) {
+        if (!comp(first[p], first[i])) {
+            std::swap(first[i], first[next++]);
+        }
+    }
+    return next;
+}
+
+// introselect: quickselect on partition_inplace, switching to median-of-medians pivots
+// when two partitions in a row fail to halve the range, so the worst case stays O(n)
+template<typename RandomIt, typename Compare>
+void quick_select_helper(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, std::ptrdiff_t k, bool median_of_medians,
+                         Compare comp) {
+    std::ptrdiff_t budget_size = r - l + 1;
+    int steps = 0;
+    while (r - l + 1 > small_sort_cutoff<iterator_value_t<RandomIt>, Compare>()) {
+        std::ptrdiff_t size = r - l + 1;
+        if (median_of_medians) {
+            median_of_medians_pivot(first, l, r, comp);
+        }
+        else {
+            choose_pivot(first, l, r, comp);
+        }
+        std::ptrdiff_t pivot_idx = partition_inplace(first, l, r, comp);
+        if (k == pivot_idx) {
+            return;
+        }
+        if (k < pivot_idx) {
+            r = pivot_idx - 1;
+        }
+        else {
+            // keys equal to the pivot all went right, split them off when they make the right side too long
+            if ((r - pivot_idx) * 10 > size * 7) {
+                std::ptrdiff_t next = partition_equal(first, pivot_idx, r, comp);
+                if (k < next) {
+                    return;
+                }
+                pivot_idx = next - 1;
+            }
+            l = pivot_idx + 1;
+        }
+        if (++steps == 2) {
+            median_of_medians = median_of_medians || (r - l + 1) * 2 > budget_size;
+            budget_size = r - l + 1;
+            steps = 0;
+        }
+    }
+    small_sort(first, l, r, comp);
+}
+
+/**
+ * Rearrange [first, last) so that *nth is the element a full sort would put there,
+ * no element before it is greater and no element after it is less
+ * O(n) worst case. Not stable.
+ */
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> quick_select(RandomIt first, RandomIt nth, RandomIt last, Compare comp = Compare()) {
+    if (nth == last) {
+        return;
+    }
+    quick_select_helper(first, 0, (last - first) - 1, nth - first, false, comp);
+}
+
+template<typename T, typename Compare = std::less<T> >
+void quick_select(std::vector<T> &vector, std::size_t k, Compare comp = Compare()) {
+    quick_select(vector.begin(), vector.begin() + std::min(k, vector.size()), vector.end(), comp);
+}
+
+/**
+ * Sort the middle - first smallest elements of [first, last) into [first, middle), the rest is left in any order
+ * A max-heap of the first middle - first elements replaces its top with every smaller element of the rest
+ * O(n log k) time for k = middle - first, O(1) extra space. Not stable.
+ */
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> partial_heap_sort(RandomIt first, RandomIt middle, RandomIt last,
+                                                      Compare comp = Compare()) {
+    std::ptrdiff_t k = middle - first;
+    if (k == 0) {
+        return;
+    }
+    for (std::ptrdiff_t i = k / 2 - 1; i >= 0; --i) {
+        sift_down(first, 0, i, k, comp);
+    }
+    for (std::ptrdiff_t i = k; i < last - first; ++i) {
+        if (comp(first[i], first[0])) {
+            std::swap(first[i], first[0]);
+            sift_down(first, 0, 0, k, comp);
+        }
+    }
+    for (std::ptrdiff_t i = k - 1; i > 0; --i) {
+        std::swap(first[0], first[i]);
+        sift_down(first, 0, 0, i, comp);
+    }
+}
+
+template<typename T, typename Compare = std::less<T> >
+void partial_heap_sort(std::vector<T> &vector, std::size_t k, Compare comp = Compare()) {
+    partial_heap_sort(vector.begin(), vector.begin() + std::min(k, vector.size()), vector.end(), comp);
+}
+
+/**
+ * The k smallest elements of a stream, kept in a bounded max-heap
+ * push is O(log k), and O(1) for elements that cannot make it into the top k
+ */
+template<typename T, typename Compare = std::less<T> >
+class TopK {
+public:
+    explicit TopK(std::size_t k, Compare comp = Compare()) : k(k), comp(comp) {
+        heap.reserve(k);
+    }
+
+    void push(const T &value) {
+        if (heap.size() < k) {
+            // sift the new element up
+            std::ptrdiff_t i = (std::ptrdiff_t)heap.size();
+            heap.push_back(value);
+            while (i > 0 && comp(heap[(i - 1) / 2], value)) {
+                heap[i] = heap[(i - 1) / 2];
+                i = (i - 1) / 2;
+            }
+            heap[i] = value;
+        }
+        else if (k > 0 && comp(value, heap[0])) {
+            heap[0] = value;
+            sift_down(heap.begin(), 0, 0, (std::ptrdiff_t)k, comp);
+        }
+    }
+
+    std::size_t size() const { return heap.size(); }
+
+    // the largest element kept, every element pushed later must be less to get in
+    const T& top() const { return heap[0]; }
+
+    // the elements kept in ascending order
+    std::vector<T> sorted() const {
+        std::vector<T> result(heap);
+        for (std::ptrdiff_t i = (std::ptrdiff_t)result.size() - 1; i > 0; --i) {
+            std::swap(result[0], result[i]);
+            sift_down(result.begin(), 0, 0, i, comp);
+        }
+        return result;
+    }
+
+private:
+    std::size_t k;
+    Compare comp;
+    std::vector<T> heap;
+};
+
+// the k smallest elements of [first, last) in ascending order, [first, last) is only read
+template<typename InputIt, typename Compare = std::less<typename std::iterator_traits<InputIt>::value_type> >
+std::vector<typename std::iterator_traits<InputIt>::value_type> top_k(InputIt first, InputIt last, std::size_t k,
+                                                                      Compare comp = Compare()) {
+    TopK<typename std::iterator_traits<InputIt>::value_type, Compare> top(k, comp);
+    for (; first != last; ++first) {
+        top.push(*first);
+    }
+    return top.sorted();
+}
+
+/*
+ * Pattern-defeating quicksort (pdqsort, Orson Peters), helpers work on half-open ranges [begin, end)
+ */
+
+// insertion sort, if !leftmost the element before begin is a sentinel not greater than any in the range
+template<typename RandomIt, typename Compare>
+void pdq_insertion_sort(RandomIt begin, RandomIt end, Compare comp, bool leftmost) {
+    if (begin == end) {
+        return;
+    }
+    for (RandomIt cur = begin + 1; cur != end; ++cur) {
+        RandomIt sift = cur;
+        RandomIt sift_1 = cur - 1;
+        if (comp(*sift, *sift_1)) {
+            iterator_value_t<RandomIt> temp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while ((!leftmost || sift != begin) && comp(temp, *--sift_1));
+            *sift = std::move(temp);
+        }
+    }
+}
+
+// insertion sort that gives up after PDQ_PARTIAL_INSERTION_SORT_LIMIT moves, return whether the range is sorted
+template<typename RandomIt, typename Compare>
+bool pdq_partial_insertion_sort(RandomIt begin, RandomIt end, Compare comp) {
+    if (begin == end) {
+        return true;
+    }
+    std::ptrdiff_t limit = 0;
+    for (RandomIt cur = begin + 1; cur != end; ++cur) {
+        RandomIt sift = cur;
+        RandomIt sift_1 = cur - 1;
+        if (comp(*sift, *sift_1)) {
+            iterator_value_t<RandomIt> temp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while (sift != begin && comp(temp, *--sift_1));
+            *sift = std::move(temp);
+            limit += cur - sift;
+        }
+        if (limit > PDQ_PARTIAL_INSERTION_SORT_LIMIT) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename RandomIt, typename Compare>
+void pdq_sort3(RandomIt a, RandomIt b, RandomIt c, Compare comp) {
+    if (comp(*b, *a)) {
+        std::iter_swap(a, b);
+    }
+    if (comp(*c, *b)) {
+        std::iter_swap(b, c);
+    }
+    if (comp(*b, *a)) {
+        std::iter_swap(a, b);
+    }
+}
+
+// swap the elements at first + offsets_l[i] and last - offsets_r[i], as one cyclic permutation when the counts match
+template<typename RandomIt>
+void pdq_swap_offsets(RandomIt first, RandomIt last, unsigned char *offsets_l, unsigned char *offsets_r,
+                      std::ptrdiff_t num, bool use_swaps) {
+    if (use_swaps) {
+        // the last pair may overlap with the cycle, so plain swaps are needed
+        for (std::ptrdiff_t i = 0; i < num; ++i) {
+            std::iter_swap(first + offsets_l[i], last - offsets_r[i]);
+        }
+    }
+    else if (num > 0) {
+        RandomIt l = first + offsets_l[0];
+        RandomIt r = last - offsets_r[0];
+        iterator_value_t<RandomIt> temp(std::move(*l));
+        *l = std::move(*r);
+        for (std::ptrdiff_t i = 1; i < num; ++i) {
+            l = first + offsets_l[i];
+            *r = std::move(*l);
+            r = last - offsets_r[i];
+            *l = std::move(*r);
+        }
+        *r = std::move(temp);
+    }
+}
+
+/**
+ * Partition [begin, end) around *begin, elements equal to the pivot go right
+ * The scans fill blocks of offsets of misplaced elements with no data-dependent branch
+ * (the comparison result is added to the block length), then the blocks are swapped pairwise
+ * @return the position of the pivot and whether the range was already partitioned
+ */
+template<typename RandomIt, typename Compare>
+std::pair<RandomIt, bool> pdq_partition_right_branchless(RandomIt begin, RandomIt end, Compare comp) {
+    iterator_value_t<RandomIt> pivot(std::move(*begin));
+    RandomIt first = begin;
+    RandomIt last = end;
+    // the median of three leaves an element not less than the pivot at the end, so the first scan stops
+    while (comp(*++first, pivot));
+    if (first - 1 == begin) {
+        while (first < last && !comp(*--last, pivot));
+    }
+    else {
+        while (!comp(*--last, pivot));
+    }
+    bool already_partitioned = first >= last;
+    if (!already_partitioned) {
+        std::iter_swap(first, last);
+        ++first;
+        alignas(64) unsigned char offsets_l[PDQ_BLOCK_SIZE];
+        alignas(64) unsigned char offsets_r[PDQ_BLOCK_SIZE];
+        RandomIt offsets_l_base = first;
+        RandomIt offsets_r_base = last;
+        std::ptrdiff_t num_l = 0;
+        std::ptrdiff_t num_r = 0;
+        std::ptrdiff_t start_l = 0;
+        std::ptrdiff_t start_r = 0;
+        while (first < last) {
+            // fill the empty blocks, splitting what is left when both are empty
+            std::ptrdiff_t num_unknown = last - first;
+            std::ptrdiff_t left_split = num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+            std::ptrdiff_t right_split = num_r == 0 ? (num_unknown - left_split) : 0;
+            left_split = std::min(left_split, (std::ptrdiff_t)PDQ_BLOCK_SIZE);
+            right_split = std::min(right_split, (std::ptrdiff_t)PDQ_BLOCK_SIZE);
+            for (std::ptrdiff_t i = 0; i < left_split; ++i) {
+                offsets_l[num_l] = (unsigned char)i;
+                num_l += !comp(*first, pivot);
+                ++first;
+            }
+            for (std::ptrdiff_t i = 0; i < right_split;) {
+                offsets_r[num_r] = (unsigned char)++i;
+                num_r += comp(*--last, pivot);
+            }
+            std::ptrdiff_t num = std::min(num_l, num_r);
+            pdq_swap_offsets(offsets_l_base, offsets_r_base, offsets_l + start_l, offsets_r + start_r,
+                             num, num_l == num_r);
+            num_l -= num;
+            num_r -= num;
+            start_l += num;
+            start_r += num;
+            if (num_l == 0) {
+                start_l = 0;
+                offsets_l_base = first;
+            }
+            if (num_r == 0) {
+                start_r = 0;
+                offsets_r_base = last;
+            }
+        }
+        // one block may still hold misplaced elements, move them to the boundary
+        if (num_l) {
+            while (num_l--) {
+                std::iter_swap(offsets_l_base + offsets_l[start_l + num_l], --last);
+            }
+            first = last;
+        }
+        if (num_r) {
+            while (num_r--) {
+                std::iter_swap(offsets_r_base - offsets_r[start_r + num_r], first);
+                ++first;
+            }
+            last = first;
+        }
+    }
+    RandomIt pivot_pos = first - 1;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return std::make_pair(pivot_pos, already_partitioned);
+}
+
+// the same partition with the classic Hoare scans, for comparisons too expensive to run unconditionally
+template<typename RandomIt, typename Compare>
+std::pair<RandomIt, bool> pdq_partition_right(RandomIt begin, RandomIt end, Compare comp) {
+    iterator_value_t<RandomIt> pivot(std::move(*begin));
+    RandomIt first = begin;
+    RandomIt last = end;
+    while (comp(*++first, pivot));
+    if (first - 1 == begin) {
+        while (first < last && !comp(*--last, pivot));
+    }
+    else {
+        while (!comp(*--last, pivot));
+    }
+    bool already_partitioned = first >= last;
+    while (first < last) {
+        std::iter_swap(first, last);
+        while (comp(*++first, pivot));
+        while (!comp(*--last, pivot));
+    }
+    RandomIt pivot_pos = first - 1;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return std::make_pair(pivot_pos, already_partitioned);
+}
+
+// partition with elements equal to the pivot going left, used when the pivot equals the element before begin,
+// so the whole run of equal keys is finished at once
+template<typename RandomIt, typename Compare>
+RandomIt pdq_partition_left(RandomIt begin, RandomIt end, Compare comp) {
+    iterator_value_t<RandomIt> pivot(std::move(*begin));
+    RandomIt first = begin;
+    RandomIt last = end;
+    while (comp(pivot, *--last));
+    if (last + 1 == end) {
+        while (first < last && !comp(pivot, *++first));
+    }
+    else {
+        while (!comp(pivot, *++first));
+    }
+    while (first < last) {
+        std::iter_swap(first, last);
+        while (comp(pivot, *--last));
+        while (!comp(pivot, *++first));
+    }
+    RandomIt pivot_pos = last;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return pivot_pos;
+}
+
+template<bool Branchless, typename RandomIt, typename Compare>
+void pdq_sort_loop(RandomIt begin, RandomIt end, Compare comp, int bad_allowed, bool leftmost) {
+    while (true) {
+        std::ptrdiff_t size = end - begin;
+        if (size < PDQ_INSERTION_SORT_CUTOFF) {
+            pdq_insertion_sort(begin, end, comp, leftmost);
+            return;
+        }
+        // median of three, or Tukey's ninther, ends up in *begin
+        std::ptrdiff_t s2 = size / 2;
+        if (size > NINTHER_THRESHOLD) {
+            pdq_sort3(begin, begin + s2, end - 1, comp);
+            pdq_sort3(begin + 1, begin + (s2 - 1), end - 2, comp);
+            pdq_sort3(begin + 2, begin + (s2 + 1), end - 3, comp);
+            pdq_sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), comp);
+            std::iter_swap(begin, begin + s2);
+        }
+        else {
+            pdq_sort3(begin + s2, begin, end - 1, comp);
+        }
+        // the pivot equals an earlier pivot: every element equal to it goes left and is done
+        if (!leftmost && !comp(*(begin - 1), *begin)) {
+            begin = pdq_partition_left(begin, end, comp) + 1;
+            continue;
+        }
+        std::pair<RandomIt, bool> part = Branchless ? pdq_partition_right_branchless(begin, end, comp)
+                                                    : pdq_partition_right(begin, end, comp);
+        RandomIt pivot_pos = part.first;
+        std::ptrdiff_t l_size = pivot_pos - begin;
+        std::ptrdiff_t r_size = end - (pivot_pos + 1);
+        if (l_size < size / 8 || r_size < size / 8) {
+            // a bad partition: after log n of them fall back to heapsort, otherwise shuffle to break the pattern
+            if (--bad_allowed == 0) {
+                heap_sort_helper(begin, 0, size - 1, comp);
+                return;
+            }
+            if (l_size >= PDQ_INSERTION_SORT_CUTOFF) {
+                std::iter_swap(begin, begin + l_size / 4);
+                std::iter_swap(pivot_pos - 1, pivot_pos - l_size / 4);
+                if (l_size > NINTHER_THRESHOLD) {
+                    std::iter_swap(begin + 1, begin + (l_size / 4 + 1));
+                    std::iter_swap(begin + 2, begin + (l_size / 4 + 2));
+                    std::iter_swap(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+                    std::iter_swap(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+                }
+            }
+            if (r_size >= PDQ_INSERTION_SORT_CUTOFF) {
+                std::iter_swap(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+                std::iter_swap(end - 1, end - r_size / 4);
+                if (r_size > NINTHER_THRESHOLD) {
+                    std::iter_swap(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+                    std::iter_swap(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+                    std::iter_swap(end - 2, end - (1 + r_size / 4));
+                    std::iter_swap(end - 3, end - (2 + r_size / 4));
+                }
+            }
+        }
+        else if (part.second && pdq_partial_insertion_sort(begin, pivot_pos, comp) &&
+                 pdq_partial_insertion_sort(pivot_pos + 1, end, comp)) {
+            // the range was already partitioned and both sides were (nearly) sorted
+            return;
+        }
+        pdq_sort_loop<Branchless>(begin, pivot_pos, comp, bad_allowed, leftmost);
+        begin = pivot_pos + 1;
+        leftmost = false;
+    }
+}
+
+// branchless partitioning pays off when comparing is cheap and has no side effects
+template<typename T, typename Compare>
+struct pdq_use_branchless : std::integral_constant<bool, std::is_arithmetic<T>::value &&
+        (std::is_same<Compare, std::less<T> >::value || std::is_same<Compare, std::greater<T> >::value)> {};
+
+/**
+ * Pattern-defeating quicksort: introsort with block partitioning, adaptive to sorted and equal-key inputs
+ * Uses branchless block partitioning for arithmetic keys under std::less / std::greater
+ * O(n log n) worst case, O(n) on sorted input and on many equal keys. Not stable.
+ */
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> pdq_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    if (last - first < 2) {
+        return;
+    }
+    int log2 = 0;
+    for (std::ptrdiff_t n = last - first; n > 1; n >>= 1) {
+        log2++;
+    }
+    pdq_sort_loop<pdq_use_branchless<iterator_value_t<RandomIt>, Compare>::value>(first, last, comp, log2, true);
+}
+
+template<typename T, typename Compare = std::less<T> >
+void pdq_sort(std::vector<T> &vector, Compare comp = Compare()) {
+    pdq_sort(vector.begin(), vector.end(), comp);
+}
+
+// pdq_sort with block partitioning for any comparator
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> pdq_sort_branchless(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    if (last - first < 2) {
+        return;
+    }
+    int log2 = 0;
+    for (std::ptrdiff_t n = last - first; n > 1; n >>= 1) {
+        log2++;
+    }
+    pdq_sort_loop<true>(first, last, comp, log2, true);
+}
+
+template<typename T, typename Compare = std::less<T> >
+void pdq_sort_branchless(std::vector<T> &vector, Compare comp = Compare()) {
+    pdq_sort_branchless(vector.begin(), vector.end(), comp);
+}
+
+// lay the sorted splitters out as an implicit binary search tree, tree[1] is the root and tree[2j], tree[2j+1]
+// are the children of tree[j]
+template<typename T>
+std::size_t sample_sort_build_tree(const std::vector<T> &splitters, std::vector<T> &tree, std::size_t node,
+                                   std::size_t index) {
+    if (node < tree.size()) {
+        index = sample_sort_build_tree(splitters, tree, 2 * node, index);
+        tree[node] = splitters[index++];
+        index = sample_sort_build_tree(splitters, tree, 2 * node + 1, index);
+    }
+    return index;
+}
+
+// bucket of every element of first[l..r], descending the splitter tree with the comparison result as the
+// next child index instead of a branch; bucket b holds the keys in (splitter b - 1, splitter b]
+template<typename RandomIt, typename T, typename Compare>
+void sample_sort_classify(RandomIt first, std::ptrdiff_t l, std::ptrdiff_t r, const std::vector<T> &tree,
+                          uint8_t *oracle, std::size_t *histogram, Compare comp) {
+    for (std::ptrdiff_t i = l; i <= r; ++i) {
+        std::size_t j = 1;
+        for (int level = 0; level < SAMPLE_SORT_LOG_BUCKETS; ++level) {
+            j = 2 * j + (std::size_t)comp(tree[j], first[i]);
+        }
+        oracle[i] = (uint8_t)(j - SAMPLE_SORT_BUCKETS);
+        histogram[j - SAMPLE_SORT_BUCKETS]++;
+    }
+}
+
+/**
+ * Parallel sample sort (super scalar sample sort, Sanders and Winkel)
+ * Splitters are taken from a sorted random sample, every thread classifies one block of the input
+ * with a branchless search over the splitters and counts its buckets, the blocks are scattered
+ * into a buffer in parallel at offsets from the prefix sums of the histograms,
+ * and then the buckets are moved back and sorted by pdq_sort in parallel
+ * O(n log n) work, O(n) extra space. Not stable.
+ * If comp throws, the exception reaches the caller once every task has stopped, and the range is left unspecified
+ * @param threads number of threads including the caller, 0 means hardware concurrency
+ */
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+enable_if_random_access_t<RandomIt> sample_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                                                unsigned threads = 0) {
+    typedef iterator_value_t<RandomIt> T;
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    std::ptrdiff_t n = last - first;
+    if (n <= SAMPLE_SORT_CUTOFF || threads <= 1) {
+        pdq_sort(first, last, comp);
+        return;
+    }
+
+    // splitters from an oversampled random sample
+    std::minstd_rand rng((unsigned)n);
+    std::vector<T> sample;
+    sample.reserve((std::size_t)SAMPLE_SORT_BUCKETS * SAMPLE_SORT_OVERSAMPLING);
+    for (int i = 0; i < SAMPLE_SORT_BUCKETS * SAMPLE_SORT_OVERSAMPLING; ++i) {
+        sample.push_back(first[std::uniform_int_distribution<std::ptrdiff_t>(0, n - 1)(rng)]);
+    }
+    pdq_sort(sample.begin(), sample.end(), comp);
+    std::vector<T> splitters;
+    for (int i = 1; i < SAMPLE_SORT_BUCKETS; ++i) {
+        splitters.push_back(sample[i * SAMPLE_SORT_OVERSAMPLING - 1]);
+    }
+    std::vector<T> tree(SAMPLE_SORT_BUCKETS, splitters[0]);
+    sample_sort_build_tree(splitters, tree, 1, 0);
+
+    // the calling thread joins the work while waiting
+    WorkStealingPool pool(threads - 1);
+    std::ptrdiff_t blocks = threads;
+    std::ptrdiff_t block_size = (n + blocks - 1) / blocks;
+    std::vector<uint8_t> oracle(n);
+    std::vector<std::size_t> histograms(blocks * SAMPLE_SORT_BUCKETS, 0);
+    {
+        TaskGroup group(pool);
+        for (std::ptrdiff_t b = 0; b < blocks; ++b) {
+            group.run([&, b]() {
+                sample_sort_classify(first, b * block_size, std::min((b + 1) * block_size, n) - 1, tree,
+                                     oracle.data(), &histograms[b * SAMPLE_SORT_BUCKETS], comp);
+            });
+        }
+        group.wait();
+    }
+
+    // bucket-major prefix sums: block b writes bucket k right after block b - 1 did
+    std::vector<std::ptrdiff_t> bucket_start(SAMPLE_SORT_BUCKETS + 1, 0);
+    std::vector<std::ptrdiff_t> offsets(blocks * SAMPLE_SORT_BUCKETS);
+    std::ptrdiff_t sum = 0;
+    for (int k = 0; k < SAMPLE_SORT_BUCKETS; ++k) {
+        bucket_start[k] = sum;
+        for (std::ptrdiff_t b = 0; b < blocks; ++b) {
+            offsets[b * SAMPLE_SORT_BUCKETS + k] = sum;
+            sum += (std::ptrdiff_t)histograms[b * SAMPLE_SORT_BUCKETS + k];
+        }
+    }
+    bucket_start[SAMPLE_SORT_BUCKETS] = n;
+
+    std::vector<T> buffer(n);
+    {
+        TaskGroup group(pool);
+        for (std::ptrdiff_t b = 0; b < blocks; ++b) {
+            group.run([&, b]() {
+                std::ptrdiff_t *offset = &offsets[b * SAMPLE_SORT_BUCKETS];
+                std::ptrdiff_t end = std::min((b + 1) * block_size, n);
+                for (std::ptrdiff_t i = b * block_size; i < end; ++i) {
+                    buffer[offset[oracle[i]]++] = std::move(first[i]);
+                }
+            });
+        }
+        group.wait();
+    }
+    {
+        TaskGroup group(pool);
+        for (int k = 0; k < SAMPLE_SORT_BUCKETS; ++k) {
+            group.run([&, k]() {
+                std::ptrdiff_t l = bucket_start[k];
+                std::ptrdiff_t r = bucket_start[k + 1];
+                std::move(buffer.begin() + l, buffer.begin() + r, first + l);
+                pdq_sort(first + l, first + r, comp);
+            });
+        }
+        group.wait();
+    }
+}
+
+template<typename T, typename Compare = std::less<T> >
+void sample_sort(std::vector<T> &vector, Compare comp = Compare(), unsigned threads = 0) {
+    sample_sort(vector.begin(), vector.end(), comp, threads);
+}
+
+/*
+ * Indirect sorts: sort small (key, index) pairs instead of fat records, then move every record once
+ */
+
+/**
+ * The permutation that sorts [first, last): first[perm[0]], first[perm[1]], ... is in order
+ * Ties keep the order of the indices, so the result is the one a stable sort would give
+ * [first, last) is not modified
+ */
+template<typename RandomIt, typename Compare = std::less<iterator_value_t<RandomIt> > >
+std::vector<std::size_t> arg_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    std::vector<std::size_t> perm(last - first);
+    for (std::size_t i = 0; i < perm.size(); ++i) {
+        perm[i] = i;
+    }
+    pdq_sort(perm.begin(), perm.end(), [&](std::size_t a, std::size_t b) {
+        if (comp(first[a], first[b])) {
+            return true;
+        }
+        return !comp(first[b], first[a]) && a < b;
+    });
+    return perm;
+}
+
+template<typename T, typename Compare = std::less<T> >
+std::vector<std::size_t> arg_sort(const std::vector<T> &vector, Compare comp = Compare()) {
+    return arg_sort(vector.begin(), vector.end(), comp);
+}
+
+/**
+ * Rearrange [first, last) so that the new first[i] is the old first[perm[i]]
+ * Follows the cycles of the permutation, every element is moved once plus one temporary per cycle
+ * @param perm a permutation of 0 .. last - first - 1, used as scratch space
+ */
+template<typename RandomIt>
+enable_if_random_access_t<RandomIt> apply_permutation(RandomIt first, RandomIt last, std::vector<std::size_t> perm) {
+    std::size_t n = last - first;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (perm[i] == i) {
+            continue;
+        }
+        iterator_value_t<RandomIt> temp = std::move(first[i]);
+        std::size_t j = i;
+        while (perm[j] != i) {
+            std::size_t next = perm[j];
+            first[j] = std::move(first[next]);
+            // a fixed point marks the position as done
+            perm[j] = j;
+            j = next;
+        }
+        first[j] = std::move(temp);
+        perm[j] = j;
+    }
+}
+
+template<typename T>
+void apply_permutation(std::vector<T> &vector, std::vector<std::size_t> perm) {
+    apply_permutation(vector.begin(), vector.end(), std::move(perm));
+}
+
+/**
+ * Sort [first, last) by the key returned by key(element)
+ * The (key, index) pairs are sorted by pdq_sort, then the records are moved into place with apply_permutation,
+ * so every record moves O(1) times whatever its size. Stable.
+ */
+template<typename RandomIt, typename KeyOf,
+    typename Compare = std::less<typename std::decay<decltype(std::declval<KeyOf&>()(*std::declval<RandomIt&>()))>::type> >
+enable_if_random_access_t<RandomIt> key_sort(RandomIt first, RandomIt last, KeyOf key, Compare comp = Compare()) {
+    typedef typename std::decay<decltype(key(*first))>::type K;
+    std::size_t n = last - first;
+    std::vector<std::pair<K, std::size_t> > keys;
+    keys.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        keys.emplace_back(key(first[i]), i);
+    }
+    pdq_sort(keys.begin(), keys.end(), [&](const std::pair<K, std::size_t> &a, const std::pair<K, std::size_t> &b) {
+        if (comp(a.first, b.first)) {
+            return true;
+        }
+        return !comp(b.first, a.first) && a.second < b.second;
+    });
+    std::vector<std::size_t> perm(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        perm[i] = keys[i].second;
+    }
+    // the keys are not needed any more, free them before moving the records
+    std::vector<std::pair<K, std::size_t> >().swap(keys);
+    apply_permutation(first, last, std::move(perm));
+}
+
+template<typename T, typename KeyOf,
+    typename Compare = std::less<typename std::decay<decltype(std::declval<KeyOf&>()(std::declval<T&>()))>::type> >
+void key_sort(std::vector<T> &vector, KeyOf key, Compare comp = Compare()) {
+    key_sort(vector.begin(), vector.end(), key, comp);
+}
+
+// radix_key maps a key to an unsigned integer of the same width and the same order
+template<typename K>
+typename std::enable_if<std::is_integral<K>::value && std::is_unsigned<K>::value, K>::type radix_key(K key) {
+    return key;
+}
+
+// flip the sign bit so that negative keys come first
+template<typename K>
+typename std::enable_if<std::is_integral<K>::value && std::is_signed<K>::value,
+                        typename std::make_unsigned<K>::type>::type radix_key(K key) {
+    typedef typename std::make_unsigned<K>::type U;
+    return (U)key ^ ((U)1 << (sizeof(U) * 8 - 1));
+}
+
+// flip every bit of negative floats and only the sign bit of the others
+inline uint32_t radix_key(float key) {
+    uint32_t bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+inline uint64_t radix_key(double key) {
+    uint64_t bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return (bits & 0x8000000000000000ull) ? ~bits : (bits | 0x8000000000000000ull);
+}
+
+/**
+ * LSD radix sort on the integral or floating-point key returned by key(element)
+ * All digit histograms are built in one pass, and passes where every key has the same digit are skipped
+ * Stable, O(n) extra space
+ */
+template<typename RandomIt, typename KeyOf>
+enable_if_random_access_t<RandomIt> radix_sort_lsd(RandomIt first, RandomIt last, KeyOf key) {
+    typedef decltype(radix_key(key(*first))) U;
+    const int passes = (int)sizeof(U) * 8 / RADIX_BITS;
+    std::ptrdiff_t n = last - first;
+    if (n <= 1) {
+        return;
+    }
+    std::vector<size_t> count(passes * RADIX_BUCKETS, 0);
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        U k = radix_key(key(first[i]));
+        for (int d = 0; d < passes; ++d) {
+            count[d * RADIX_BUCKETS + ((k >> (d * RADIX_BITS)) & (RADIX_BUCKETS - 1))]++;
+        }
+    }
+    std::vector<iterator_value_t<RandomIt> > buffer(n);
+    auto scatter = [&key, n](auto src, auto dst, size_t *offset, int shift) {
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            dst[offset[(radix_key(key(src[i])) >> shift) & (RADIX_BUCKETS - 1)]++] = std::move(src[i]);
+        }
+    };
+    bool in_buffer = false;
+    for (int d = 0; d < passes; ++d) {
+        size_t *offset = &count[d * RADIX_BUCKETS];
+        int shift = d * RADIX_BITS;
+        U k = radix_key(key(in_buffer ? buffer[0] : first[0]));
+        if (offset[(k >> shift) & (RADIX_BUCKETS - 1)] == (size_t)n) {
+            continue;
+        }
+        size_t sum = 0;
+        for (int b = 0; b < RADIX_BUCKETS; ++b) {
+            size_t c = offset[b];
+            offset[b] = sum;
+            sum += c;
+        }
+        if (in_buffer) {
+            scatter(buffer.begin(), first, offset, shift);
+        }
+        else {
+            scatter(first, buffer.begin(), offset, shift);
+        }
+        in_buffer = !in_buffer;
+    }
+    if (in_buffer) {
+        std::move(buffer.begin(), buffer.end(), first);
+    }
+}
+
+template<typename RandomIt>
+enable_if_random_access_t<RandomIt> radix_sort_lsd(RandomIt first, RandomIt last) {
+    radix_sort_lsd(first, last, [](const iterator_value_t<RandomIt> &x) { return x; });
+}
+
+template<typename T, typename KeyOf>
+void radix_sort_lsd(std::vector<T> &vector, KeyOf key) {
+    radix_sort_lsd(vector.begin(), vector.end(), key);
+}
+
+template<typename T>
+void radix_sort_lsd(std::vector<T> &vector) {
+    radix_sort_lsd(vector.begin(), vector.end());
+}
+
+// sort first[l..r] by the digits at shift and below, the digits above are all the same
+template<typename RandomIt, typename BufferIt, typename KeyOf>
+void radix_sort_msd_helper(RandomIt first, BufferIt buffer, std::ptrdiff_t l, std::ptrdiff_t r, int shift, KeyOf key) {
+    typedef iterator_value_t<RandomIt> T;
+    size_t count[RADIX_BUCKETS + 1];
+    while (true) {
+        if (r - l + 1 <= RADIX_SORT_MSD_CUTOFF) {
+            insertion_sort_helper(first, l, r, [&key](const T &a, const T &b) {
+                return radix_key(key(a)) < radix_key(key(b));
+            });
+            return;
+        }
+        std::fill(count, count + RADIX_BUCKETS + 1, 0);
+        for (std::ptrdiff_t i = l; i <= r; ++i) {
+            count[((radix_key(key(first[i])) >> shift) & (RADIX_BUCKETS - 1)) + 1]++;
+        }
+        // every key has the same digit, go straight to the next one
+        if (count[((radix_key(key(first[l])) >> shift) & (RADIX_BUCKETS - 1)) + 1] == (size_t)(r - l + 1)) {
+            if (shift == 0) {
+                return;
+            }
+            shift -= RADIX_BITS;
+            continue;
+        }
+        break;
+    }
+    for (int b = 0; b < RADIX_BUCKETS; ++b) {
+        count[b + 1] += count[b];
+    }
+    for (std::ptrdiff_t i = l; i <= r; ++i) {
+        buffer[l + count[(radix_key(key(first[i])) >> shift) & (RADIX_BUCKETS - 1)]++] = std::move(first[i]);
+    }
+    for (std::ptrdiff_t i = l; i <= r; ++i) {
+        first[i] = std::move(buffer[i]);
+    }
+    if (shift == 0) {
+        return;
+    }
+    // count[b] is now the end of bucket b
+    std::ptrdiff_t begin = l;
+    for (int b = 0; b < RADIX_BUCKETS; ++b) {
+        std::ptrdiff_t end = l + (std::ptrdiff_t)count[b];
+        if (end - begin > 1) {
+            radix_sort_msd_helper(first, buffer, begin, end - 1, shift - RADIX_BITS, key);
+        }
+        begin = end;
+    }
+}
+
+/**
+ * MSD radix sort on the integral or floating-point key returned by key(element)
+ * Digits shared by a whole bucket are skipped, and small buckets go to insertion sort,
+ * so skewed keys cost few passes
+ * Stable, O(n) extra space: the scatter keeps the order within a bucket and the insertion sort keeps equal keys in order
+ */
+template<typename RandomIt, typename KeyOf>
+enable_if_random_access_t<RandomIt> radix_sort_msd(RandomIt first, RandomIt last, KeyOf key) {
+    typedef decltype(radix_key(key(*first))) U;
+    if (last - first <= 1) {
+        return;
+    }
+    std::vector<iterator_value_t<RandomIt> > buffer(last - first);
+    radix_sort_msd_helper(first, buffer.begin(), 0, (last - first) - 1, (int)sizeof(U) * 8 - RADIX_BITS, key);
+}
+
+template<typename RandomIt>
+enable_if_random_access_t<RandomIt> radix_sort_msd(RandomIt first, RandomIt last) {
+    radix_sort_msd(first, last, [](const iterator_value_t<RandomIt> &x) { return x; });
+}
+
+template<typename T, typename KeyOf>
+void radix_sort_msd(std::vector<T> &vector, KeyOf key) {
+    radix_sort_msd(vector.begin(), vector.end(), key);
+}
+
+template<typename T>
+void radix_sort_msd(std::vector<T> &vector) {
+    radix_sort_msd(vector.begin(), vector.end());
 }
 
 #endif //VE281P1_SORT_HPP
@@ -0,0 +1,139 @@
+#ifndef VE281P1_STRING_SORT_HPP
+#define VE281P1_STRING_SORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "sort.hpp"
+
+// groups not longer than this are finished by insertion_sort_helper in string_sort
+static constexpr int STRING_SORT_CUTOFF = 16;
+
+/**
+ * One string of the range being sorted, with the 8 bytes at the current depth cached as a big-endian integer,
+ * so comparing two cached prefixes is one integer comparison on contiguous memory
+ */
+struct StringSortEntry {
+    uint64_t prefix;        // bytes depth .. depth + 7, zero padded
+    uint32_t tail;          // how many of those bytes exist, 8 unless the string ends before depth + 8
+    const char *data;
+    std::size_t size;
+    std::size_t index;      // position in the input
+};
+
+// the bytes data[depth .. depth + 7] as a big-endian integer, zero padded past size
+inline uint64_t string_prefix(const char *data, std::size_t size, std::size_t depth, uint32_t &tail) {
+    if (depth + 8 <= size) {
+        tail = 8;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        uint64_t word;
+        std::memcpy(&word, data + depth, 8);
+        return __builtin_bswap64(word);
+#endif
+    }
+    tail = depth < size ? (uint32_t)std::min<std::size_t>(size - depth, 8) : 0;
+    uint64_t prefix = 0;
+    for (uint32_t i = 0; i < 8; ++i) {
+        prefix = (prefix << 8) | (i < tail ? (unsigned char)data[depth + i] : 0);
+    }
+    return prefix;
+}
+
+/*
+ * (prefix, tail) orders the strings by their bytes depth .. depth + 7: padding zeros tie with real zeros,
+ * and then the string with fewer real bytes, which ended first, is the smaller one.
+ * Equal (prefix, tail) with tail < 8 means the strings are equal.
+ */
+inline bool string_prefix_less(const StringSortEntry &a, const StringSortEntry &b) {
+    return a.prefix < b.prefix || (a.prefix == b.prefix && a.tail < b.tail);
+}
+
+// compare the whole suffixes from depth, cached prefix first
+struct StringSuffixLess {
+    std::size_t depth;
+
+    bool operator()(const StringSortEntry &a, const StringSortEntry &b) const {
+        if (a.prefix != b.prefix || a.tail != b.tail) {
+            return string_prefix_less(a, b);
+        }
+        if (a.tail < 8) {
+            return false;
+        }
+        std::size_t skip = depth + 8;
+        return std::string_view(a.data + skip, a.size - skip) < std::string_view(b.data + skip, b.size - skip);
+    }
+};
+
+/**
+ * Multikey quicksort (Bentley and Sedgewick) of entries[l..r], all equal in their first depth bytes
+ * partition_3way on the cached prefixes splits off the smaller and greater groups, which are sorted at the same depth,
+ * and the equal group moves 8 bytes deeper with its prefixes reloaded
+ * Only the smaller and greater groups cost stack and depth_limit, after which heapsort on whole suffixes takes over
+ */
+inline void string_sort_helper(std::vector<StringSortEntry> &entries, std::ptrdiff_t l, std::ptrdiff_t r,
+                               std::size_t depth, int depth_limit) {
+    auto first = entries.begin();
+    auto prefix_less = [](const StringSortEntry &a, const StringSortEntry &b) { return string_prefix_less(a, b); };
+    while (r - l + 1 > STRING_SORT_CUTOFF) {
+        if (depth_limit == 0) {
+            heap_sort_helper(first, l, r, StringSuffixLess{depth});
+            return;
+        }
+        choose_pivot(first, l, r, prefix_less);
+        std::pair<std::ptrdiff_t, std::ptrdiff_t> equal = partition_3way(first, l, r, prefix_less);
+        string_sort_helper(entries, l, equal.first - 1, depth, depth_limit - 1);
+        string_sort_helper(entries, equal.second + 1, r, depth, depth_limit - 1);
+        if (entries[equal.first].tail < 8) {
+            return;
+        }
+        l = equal.first;
+        r = equal.second;
+        depth += 8;
+        for (std::ptrdiff_t i = l; i <= r; ++i) {
+            entries[i].prefix = string_prefix(entries[i].data, entries[i].size, depth, entries[i].tail);
+        }
+    }
+    insertion_sort_helper(first, l, r, StringSuffixLess{depth});
+}
+
+/**
+ * Sort a range of std::string or std::string_view in byte-wise (std::string::compare) order
+ * The strings are sorted through a side array of cached 8-byte prefixes, so shared prefixes are
+ * compared 8 bytes at a time and each string is moved once at the end by apply_permutation
+ * O(n log n + D) expected for D the number of distinguishing bytes. Not stable.
+ */
+template<typename RandomIt>
+enable_if_random_access_t<RandomIt> string_sort(RandomIt first, RandomIt last) {
+    std::size_t n = last - first;
+    if (n < 2) {
+        return;
+    }
+    std::vector<StringSortEntry> entries(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        std::string_view s(first[i]);
+        entries[i].data = s.data();
+        entries[i].size = s.size();
+        entries[i].index = i;
+        entries[i].prefix = string_prefix(s.data(), s.size(), 0, entries[i].tail);
+    }
+    string_sort_helper(entries, 0, (std::ptrdiff_t)n - 1, 0, introsort_depth_limit((std::ptrdiff_t)n));
+    std::vector<std::size_t> perm(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        perm[i] = entries[i].index;
+    }
+    apply_permutation(first, last, std::move(perm));
+}
+
+inline void string_sort(std::vector<std::string> &vector) {
+    string_sort(vector.begin(), vector.end());
+}
+
+inline void string_sort(std::vector<std::string_view> &vector) {
+    string_sort(vector.begin(), vector.end());
+}
+
+#endif //VE281P1_STRING_SORT_HPP
@@ -1,48 +1,434 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <atomic>
 #include <random>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include "sort.hpp"
+#include "string_sort.hpp"
+// this is the one translation unit of the benchmark, it may replace operator new
+#define SORT_INSTRUMENTATION_TRACK_ALLOCATIONS
+#include "instrumentation.hpp"
 using namespace std;
 
-int main() {
-    random_device rd;
-    minstd_rand rng(rd());
-    vector<int> test1, test2, test3, test4, test5, test6, test7;
-    for (int i = 0; i < 25;++i) {
-        auto a = rng();
-        test1.push_back(a);
-        test2.push_back(a);
-        test3.push_back(a);
-        test4.push_back(a);
-        test5.push_back(a);
-        test6.push_back(a);
-        test7.push_back(a);
-    }
-    auto t0 = chrono::steady_clock::now();
-    auto t1 = chrono::steady_clock::now();
-    bubble_sort(test1);
-    auto t2 = chrono::steady_clock::now();
-    insertion_sort(test2);
-    auto t3 = chrono::steady_clock::now();
-    selection_sort(test3);
-    auto t4 = chrono::steady_clock::now();
-    merge_sort(test4);
-    auto t5 = chrono::steady_clock::now();
-    quick_sort_extra(test5);
-    auto t6 = chrono::steady_clock::now();
-    quick_sort_inplace(test6);
-    auto t7 = chrono::steady_clock::now();
-    sort(test7.begin(), test7.end());
-    auto t8 = chrono::steady_clock::now();
-    double bubble = chrono::duration<double, milli>(t2 - t1).count();
-    double insertion = chrono::duration<double, milli>(t3 - t2).count();
-    double selection = chrono::duration<double, milli>(t4 - t3).count();
-    double merge = chrono::duration<double, milli>(t5 - t4).count();
-    double quick_e = chrono::duration<double, milli>(t6 - t5).count();
-    double quick_i = chrono::duration<double, milli>(t7 - t6).count();
-    double sortstd = chrono::duration<double, milli>(t8 - t7).count();
-    cout << bubble << " " << insertion << " " << selection << " " << merge << " " << quick_e << " " << quick_i << " " << sortstd << endl;
+/*
+ * Sort benchmark: every algorithm on every input distribution, element type and size
+ * Each case gets one warm-up run and then --trials timed runs on fresh copies of the same input,
+ * every output is checked against std::stable_sort, and one CSV or JSON row per case is printed
+ * Before that, the parallel sorts must pass a comparator exception on to the caller
+ *
+ * usage: test [--sizes=10,1000 | --max-size=N] [--trials=N] [--swaps=K] [--format=csv|json]
+ *             [--types=int,double,string,record] [--distributions=random,...] [--algorithms=pdq_sort,...]
+ *
+ * Build with -DSORT_INSTRUMENTATION to add the comparisons, copies, moves, allocations and hardware counters
+ * of the median run, the elements are then wrapped in Counted so that their copies and moves are seen.
+ */
+
+// counting comparisons would hide std::less from the sorts that specialize on it, so only instrumented builds do
+#if defined(SORT_INSTRUMENTATION)
+template<typename T>
+using Less = CountingCompare<less<T> >;
+#else
+template<typename T>
+using Less = less<T>;
+#endif
+
+// the type the sorts see for elements of type T, and the element value the key based sorts read
+#if defined(SORT_INSTRUMENTATION)
+template<typename T>
+using Element = Counted<T>;
+
+template<typename T>
+const T& value_of(const Counted<T> &element) { return element.value; }
+#else
+template<typename T>
+using Element = T;
+
+template<typename T>
+const T& value_of(const T &element) { return element; }
+#endif
+
+// the quadratic sorts are skipped above this size
+static const size_t QUADRATIC_MAX = 1 << 12;
+
+// a fat element: sorted by key, the payload only makes it expensive to move
+struct Record {
+    int64_t key;
+    char payload[248];
+
+    bool operator<(const Record &other) const { return key < other.key; }
+
+    bool operator==(const Record &other) const {
+        return key == other.key && memcmp(payload, other.payload, sizeof(payload)) == 0;
+    }
+};
+
+struct Options {
+    vector<size_t> sizes;
+    size_t trials = 5;
+    size_t swaps = 16;
+    string format = "csv";
+    vector<string> types = {"int", "double", "string", "record"};
+    vector<string> distributions = {"random", "sorted", "reversed", "organ_pipe", "few_unique", "nearly_sorted", "zipf"};
+    vector<string> algorithms;      // empty means all
+};
+
+struct Result {
+    string type;
+    string distribution;
+    size_t size;
+    string algorithm;
+    size_t trials;
+    double median;
+    double p95;
+    double min;
+    bool sorted;
+    SortCounters counters;          // of the median run
+};
+
+vector<string> split(const string &list) {
+    vector<string> items;
+    stringstream stream(list);
+    string item;
+    while (getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+bool selected(const vector<string> &list, const string &name) {
+    return list.empty() || find(list.begin(), list.end(), name) != list.end();
+}
+
+// Zipf(1) ranks over min(n, 1M) values by inverting the cumulative distribution
+vector<int64_t> zipf(size_t n, minstd_rand &rng) {
+    size_t values = min(n, (size_t)1000000);
+    vector<double> cdf(values);
+    double sum = 0;
+    for (size_t i = 0; i < values; ++i) {
+        sum += 1.0 / (double)(i + 1);
+        cdf[i] = sum;
+    }
+    uniform_real_distribution<double> uniform(0, sum);
+    vector<int64_t> keys(n);
+    for (auto &key : keys) {
+        key = lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+    }
+    return keys;
+}
+
+vector<int64_t> generate(const string &distribution, size_t n, size_t swaps, minstd_rand &rng) {
+    vector<int64_t> keys(n);
+    if (distribution == "zipf") {
+        return zipf(n, rng);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (distribution == "random") {
+            keys[i] = (int64_t)(rng() % 1000000000);
+        }
+        else if (distribution == "sorted" || distribution == "nearly_sorted") {
+            keys[i] = (int64_t)i;
+        }
+        else if (distribution == "reversed") {
+            keys[i] = (int64_t)(n - i);
+        }
+        else if (distribution == "organ_pipe") {
+            keys[i] = (int64_t)(i < n / 2 ? i : n - i);
+        }
+        else if (distribution == "few_unique") {
+            keys[i] = (int64_t)(rng() % 16);
+        }
+    }
+    if (distribution == "nearly_sorted" && n > 1) {
+        for (size_t i = 0; i < swaps; ++i) {
+            swap(keys[rng() % n], keys[rng() % n]);
+        }
+    }
+    return keys;
+}
+
+template<typename T>
+T make_element(int64_t key);
+
+template<>
+int make_element<int>(int64_t key) { return (int)key; }
+
+template<>
+double make_element<double>(int64_t key) { return (double)key * 0.5; }
+
+// zero padded so that string order is key order
+template<>
+string make_element<string>(int64_t key) {
+    string digits = to_string(key);
+    return "key:" + string(digits.size() < 12 ? 12 - digits.size() : 0, '0') + digits;
+}
+
+template<>
+Record make_element<Record>(int64_t key) {
+    Record record;
+    record.key = key;
+    memset(record.payload, (int)(key & 0xff), sizeof(record.payload));
+    return record;
+}
+
+template<typename T>
+vector<pair<string, function<void(vector<Element<T> >&)> > > algorithms() {
+    typedef Element<T> E;
+    vector<pair<string, function<void(vector<E>&)> > > list = {
+        {"bubble_sort", [](vector<E> &v) { bubble_sort(v, Less<E>()); }},
+        {"insertion_sort", [](vector<E> &v) { insertion_sort(v, Less<E>()); }},
+        {"selection_sort", [](vector<E> &v) { selection_sort(v, Less<E>()); }},
+        {"merge_sort", [](vector<E> &v) { merge_sort(v, Less<E>()); }},
+        {"merge_sort_parallel", [](vector<E> &v) { merge_sort_parallel(v, Less<E>()); }},
+        {"merge_sort_bottom_up", [](vector<E> &v) { merge_sort_bottom_up(v, Less<E>()); }},
+        {"tim_sort", [](vector<E> &v) { tim_sort(v, Less<E>()); }},
+        {"quick_sort_extra", [](vector<E> &v) { quick_sort_extra(v, Less<E>()); }},
+        {"quick_sort_inplace", [](vector<E> &v) { quick_sort_inplace(v, Less<E>()); }},
+        {"quick_sort_3way", [](vector<E> &v) { quick_sort_3way(v, Less<E>()); }},
+        {"pdq_sort", [](vector<E> &v) { pdq_sort(v, Less<E>()); }},
+        {"sample_sort", [](vector<E> &v) { sample_sort(v, Less<E>()); }},
+        {"std_sort", [](vector<E> &v) { sort(v.begin(), v.end(), Less<E>()); }},
+        {"std_stable_sort", [](vector<E> &v) { stable_sort(v.begin(), v.end(), Less<E>()); }},
+    };
+    if constexpr (is_arithmetic<T>::value) {
+        list.push_back({"radix_sort_lsd", [](vector<E> &v) { radix_sort_lsd(v, [](const E &x) { return value_of(x); }); }});
+        list.push_back({"radix_sort_msd", [](vector<E> &v) { radix_sort_msd(v, [](const E &x) { return value_of(x); }); }});
+    }
+    // string_sort only takes std::string, so it cannot run on the Counted strings of instrumented builds
+    if constexpr (is_same<E, string>::value) {
+        list.push_back({"string_sort", [](vector<E> &v) { string_sort(v); }});
+    }
+    if constexpr (is_same<T, Record>::value) {
+        list.push_back({"key_sort", [](vector<E> &v) { key_sort(v, [](const E &r) { return value_of(r).key; }, Less<int64_t>()); }});
+        list.push_back({"radix_sort_lsd", [](vector<E> &v) { radix_sort_lsd(v, [](const E &r) { return value_of(r).key; }); }});
+    }
+    return list;
+}
+
+// nearest-rank percentile of sorted times
+double percentile(const vector<double> &times, double p) {
+    size_t rank = (size_t)ceil(p * (double)times.size());
+    return times[rank == 0 ? 0 : rank - 1];
+}
+
+template<typename T>
+void run(const string &type, const Options &options, vector<Result> &results) {
+    auto list = algorithms<T>();
+    for (auto &distribution : options.distributions) {
+        for (size_t n : options.sizes) {
+            minstd_rand rng((unsigned)(n * 31 + distribution.size()));
+            vector<int64_t> keys = generate(distribution, n, options.swaps, rng);
+            vector<Element<T> > input;
+            input.reserve(n);
+            for (auto key : keys) {
+                input.push_back(make_element<T>(key));
+            }
+            vector<Element<T> > expected = input;
+            stable_sort(expected.begin(), expected.end());
+            for (auto &algorithm : list) {
+                bool quadratic = algorithm.first == "bubble_sort" || algorithm.first == "insertion_sort" ||
+                                 algorithm.first == "selection_sort";
+                if (!selected(options.algorithms, algorithm.first) || (quadratic && n > QUADRATIC_MAX)) {
+                    continue;
+                }
+                Result result = {type, distribution, n, algorithm.first, options.trials, 0, 0, 0, true, SortCounters()};
+                vector<Element<T> > data = input;
+                algorithm.second(data);
+                result.sorted = data == expected;
+                vector<SortCounters> runs;
+                for (size_t trial = 0; trial < options.trials; ++trial) {
+                    data = input;
+                    runs.push_back(measure([&]() { algorithm.second(data); }));
+                    result.sorted = result.sorted && data == expected;
+                }
+                sort(runs.begin(), runs.end(), [](const SortCounters &a, const SortCounters &b) {
+                    return a.milliseconds < b.milliseconds;
+                });
+                vector<double> times;
+                for (auto &counters : runs) {
+                    times.push_back(counters.milliseconds);
+                }
+                result.median = percentile(times, 0.5);
+                result.p95 = percentile(times, 0.95);
+                result.min = times[0];
+                result.counters = runs[(runs.size() - 1) / 2];
+                results.push_back(result);
+                cerr << type << " " << distribution << " " << n << " " << algorithm.first << " " << result.median
+                     << " ms" << (result.sorted ? "" : " NOT SORTED") << endl;
+            }
+        }
+    }
+}
+
+void print_csv(const vector<Result> &results) {
+    cout << "type,distribution,size,algorithm,trials,median_ms,p95_ms,min_ms,sorted";
+#if defined(SORT_INSTRUMENTATION)
+    cout << ",comparisons,copies,moves,allocations,cycles,branch_misses,cache_misses";
+#endif
+    cout << endl;
+    for (auto &r : results) {
+        cout << r.type << "," << r.distribution << "," << r.size << "," << r.algorithm << "," << r.trials << ","
+             << r.median << "," << r.p95 << "," << r.min << "," << (r.sorted ? "true" : "false");
+#if defined(SORT_INSTRUMENTATION)
+        cout << "," << r.counters.comparisons << "," << r.counters.copies << "," << r.counters.moves << ","
+             << r.counters.allocations << "," << r.counters.cycles << "," << r.counters.branchMisses << ","
+             << r.counters.cacheMisses;
+#endif
+        cout << endl;
+    }
+}
+
+void print_json(const vector<Result> &results) {
+    cout << "[" << endl;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        cout << "  {\"type\": \"" << r.type << "\", \"distribution\": \"" << r.distribution << "\", \"size\": "
+             << r.size << ", \"algorithm\": \"" << r.algorithm << "\", \"trials\": " << r.trials
+             << ", \"median_ms\": " << r.median << ", \"p95_ms\": " << r.p95 << ", \"min_ms\": " << r.min
+             << ", \"sorted\": " << (r.sorted ? "true" : "false");
+#if defined(SORT_INSTRUMENTATION)
+        cout << ", \"comparisons\": " << r.counters.comparisons << ", \"copies\": " << r.counters.copies
+             << ", \"moves\": " << r.counters.moves << ", \"allocations\": " << r.counters.allocations
+             << ", \"cycles\": " << r.counters.cycles << ", \"branch_misses\": " << r.counters.branchMisses
+             << ", \"cache_misses\": " << r.counters.cacheMisses;
+#endif
+        cout << "}" << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    cout << "]" << endl;
+}
+
+// a comparator that throws once it has been called limit times, from any thread
+struct ThrowingCompare {
+    atomic<size_t> *calls;
+    size_t limit;
+
+    bool operator()(int a, int b) const {
+        if (calls->fetch_add(1) + 1 == limit) {
+            throw runtime_error("comparator failed");
+        }
+        return a < b;
+    }
+};
+
+// a comparator exception thrown in any phase of the parallel sorts must reach the caller
+bool comparator_exceptions() {
+    const size_t n = 1000000;
+    minstd_rand rng(281);
+    vector<int> input(n);
+    for (auto &x : input) {
+        x = (int)rng();
+    }
+    vector<pair<string, function<void(vector<int>&, ThrowingCompare)> > > list = {
+        {"merge_sort_parallel", [](vector<int> &v, ThrowingCompare comp) { merge_sort_parallel(v, comp); }},
+        {"sample_sort", [](vector<int> &v, ThrowingCompare comp) { sample_sort(v, comp, 4); }},
+    };
+    bool ok = true;
+    for (auto &algorithm : list) {
+        // the number of comparisons of a full run, then throw early, halfway and late in it
+        atomic<size_t> calls(0);
+        vector<int> data = input;
+        algorithm.second(data, ThrowingCompare{&calls, 0});
+        size_t total = calls;
+        for (size_t limit : {total / 100, total / 2, total - total / 10}) {
+            calls = 0;
+            data = input;
+            bool caught = false;
+            try {
+                algorithm.second(data, ThrowingCompare{&calls, limit});
+            }
+            catch (const runtime_error &) {
+                caught = true;
+            }
+            ok = ok && caught;
+            if (!caught) {
+                cerr << algorithm.first << " lost the exception of comparison " << limit << " of " << total << endl;
+            }
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    size_t max_size = 1000000;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string value = eq == string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--sizes") {
+            for (auto &size : split(value)) {
+                options.sizes.push_back(stoull(size));
+            }
+        }
+        else if (key == "--max-size") {
+            max_size = stoull(value);
+        }
+        else if (key == "--trials") {
+            options.trials = max((size_t)1, (size_t)stoull(value));
+        }
+        else if (key == "--swaps") {
+            options.swaps = stoull(value);
+        }
+        else if (key == "--format") {
+            options.format = value;
+        }
+        else if (key == "--types") {
+            options.types = split(value);
+        }
+        else if (key == "--distributions") {
+            options.distributions = split(value);
+        }
+        else if (key == "--algorithms") {
+            options.algorithms = split(value);
+        }
+        else {
+            cerr << "unknown option " << arg << endl;
+            return 1;
+        }
+    }
+    if (options.sizes.empty()) {
+        // 10, 100, ... up to max_size (10^8 at most)
+        for (size_t n = 10; n <= min(max_size, (size_t)100000000); n *= 10) {
+            options.sizes.push_back(n);
+        }
+    }
+    if (!comparator_exceptions()) {
+        return 1;
+    }
+    vector<Result> results;
+    if (selected(options.types, "int")) {
+        run<int>("int", options, results);
+    }
+    if (selected(options.types, "double")) {
+        run<double>("double", options, results);
+    }
+    if (selected(options.types, "string")) {
+        run<string>("string", options, results);
+    }
+    if (selected(options.types, "record")) {
+        run<Record>("record", options, results);
+    }
+    if (options.format == "json") {
+        print_json(results);
+    }
+    else {
+        print_csv(results);
+    }
+    for (auto &r : results) {
+        if (!r.sorted) {
+            return 1;
+        }
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,246 @@
+#ifndef VE281P1_THREAD_POOL_HPP
+#define VE281P1_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A work-stealing thread pool for fork-join style algorithms
+ * Every worker owns a deque: it pushes and pops its own tasks at the back (LIFO),
+ * and steals from the front of the other deques (FIFO) when it runs out of work.
+ * Threads outside the pool push into an extra shared deque.
+ * A thread waiting for its subtasks keeps running tasks instead of blocking,
+ * so nested parallelism never deadlocks.
+ */
+class WorkStealingPool {
+public:
+    typedef std::function<void()> Task;
+
+    /**
+     * @param threads number of worker threads, 0 means hardware concurrency
+     */
+    explicit WorkStealingPool(unsigned threads = 0) : done(false), queued(0) {
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (unsigned i = 0; i <= threads; ++i) {
+            queues.emplace_back(new Queue);
+        }
+        for (unsigned i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i]() { work(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            done = true;
+        }
+        sleepCond.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @return the number of worker threads
+     */
+    size_t size() const { return workers.size(); }
+
+    /**
+     * Push a task into the deque of the calling worker, or into the shared deque
+     * @param task
+     */
+    void submit(Task task) {
+        Queue &queue = *queues[currentQueue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued++;
+        }
+        sleepCond.notify_one();
+    }
+
+    /**
+     * Run one pending task on the calling thread, if there is any
+     * @return whether a task was run
+     */
+    bool runPendingTask() {
+        Task task;
+        if (!take(currentQueue(), task)) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue> > queues;    // one per worker, the last one is shared
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable sleepCond;
+    bool done;                                      // guarded by sleepMutex
+    std::atomic<size_t> queued;                     // number of tasks in all deques
+
+    static const WorkStealingPool *&currentPool() {
+        static thread_local const WorkStealingPool *pool = nullptr;
+        return pool;
+    }
+
+    static size_t &currentIndex() {
+        static thread_local size_t index = 0;
+        return index;
+    }
+
+    size_t currentQueue() const {
+        return currentPool() == this ? currentIndex() : workers.size();
+    }
+
+    /**
+     * Pop from the back of the own deque, otherwise steal from the front of another one
+     */
+    bool take(size_t self, Task &task) {
+        if (queued.load() == 0) {
+            return false;
+        }
+        {
+            Queue &queue = *queues[self];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                queued--;
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            Queue &victim = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queued--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(size_t index) {
+        currentPool() = this;
+        currentIndex() = index;
+        Task task;
+        while (true) {
+            if (take(index, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCond.wait(lock, [this]() { return done || queued.load() > 0; });
+            if (done) {
+                return;
+            }
+        }
+    }
+};
+
+/**
+ * A group of tasks forked from one thread and joined by wait()
+ * The first exception thrown by a task is kept and rethrown by wait(), later ones are dropped.
+ * Like a joinable std::thread, a group destroyed with an exception no one waited for calls std::terminate,
+ * unless the destructor runs during stack unwinding, when that exception is already on its way up
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(WorkStealingPool &pool) : pool(pool), pending(0), uncaught(std::uncaught_exceptions()) {}
+
+    TaskGroup(const TaskGroup&) = delete;
+
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    // a destructor must not throw, so a task exception no one waited for is a programming error
+    ~TaskGroup() {
+        join();
+        if (error && std::uncaught_exceptions() == uncaught) {
+            std::terminate();
+        }
+    }
+
+    template<typename F>
+    void run(F f) {
+        pending++;
+        pool.submit([this, f]() {
+            // the task counts as finished however it ends, or wait() would never return
+            struct Finish {
+                std::atomic<size_t> &pending;
+                ~Finish() { pending--; }
+            } finish{pending};
+            try {
+                f();
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        });
+    }
+
+    /**
+     * Help the pool until every task of the group is finished
+     * @throw the first exception thrown by a task of the group since the last wait()
+     */
+    void wait() {
+        join();
+        std::exception_ptr thrown;
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            thrown.swap(error);
+        }
+        if (thrown) {
+            std::rethrow_exception(thrown);
+        }
+    }
+
+private:
+    WorkStealingPool &pool;
+    std::atomic<size_t> pending;
+    std::mutex errorMutex;
+    std::exception_ptr error;       // guarded by errorMutex
+    int uncaught;                   // std::uncaught_exceptions() when the group was made
+
+    void join() {
+        while (pending.load() != 0) {
+            if (!pool.runPendingTask()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+#endif //VE281P1_THREAD_POOL_HPP
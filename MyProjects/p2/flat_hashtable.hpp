@@ -0,0 +1,561 @@
+#ifndef VE281P2_FLAT_HASHTABLE_HPP
+#define VE281P2_FLAT_HASHTABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLAT_HASHTABLE_SSE2
+#endif
+
+/**
+ * The control bytes of one group of FlatHashTable slots, matched all at once
+ * Bit i of every mask stands for slot i of the group
+ */
+struct FlatGroup {
+    static constexpr size_t WIDTH = 16;
+    static constexpr int8_t EMPTY = -128;       // 0b10000000
+    static constexpr int8_t DELETED = -2;       // 0b11111110, a tombstone
+    // a full slot holds the 7 low bits of the hash of its key, so its control byte is never negative
+
+#if defined(FLAT_HASHTABLE_SSE2)
+    __m128i ctrl;
+
+    explicit FlatGroup(const int8_t* pos) : ctrl(_mm_loadu_si128((const __m128i*)pos)) {}
+
+    uint32_t match(int8_t tag) const {
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), ctrl));
+    }
+
+    uint32_t matchEmpty() const { return match(EMPTY); }
+
+    // EMPTY and DELETED are exactly the bytes with the sign bit set
+    uint32_t matchEmptyOrDeleted() const { return (uint32_t)_mm_movemask_epi8(ctrl); }
+#else
+    // the 16 control bytes as two little-endian words, matched 8 bytes at a time (SWAR)
+    uint64_t words[2];
+
+    explicit FlatGroup(const int8_t* pos) {
+        std::memcpy(words, pos, WIDTH);
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        words[0] = __builtin_bswap64(words[0]);
+        words[1] = __builtin_bswap64(words[1]);
+#endif
+    }
+
+    // one bit per byte from the high bit of every byte of the two words
+    static uint32_t compress(uint64_t low, uint64_t high) {
+        auto bits = [](uint64_t word) { return (uint32_t)((((word >> 7) & 0x0101010101010101ull) * 0x0102040810204080ull) >> 56); };
+        return bits(low) | (bits(high) << 8);
+    }
+
+    uint32_t match(int8_t tag) const {
+        const uint64_t low7 = 0x7f7f7f7f7f7f7f7full;
+        uint64_t pattern = 0x0101010101010101ull * (uint8_t)tag;
+        // exactly the zero bytes of word ^ pattern get their high bit set
+        auto zero = [low7](uint64_t word) { return ~(((word & low7) + low7) | word | low7); };
+        return compress(zero(words[0] ^ pattern), zero(words[1] ^ pattern));
+    }
+
+    // EMPTY is the only control byte with the high bit set and bit 1 clear
+    uint32_t matchEmpty() const { return compress(words[0] & ~(words[0] << 6), words[1] & ~(words[1] << 6)); }
+
+    uint32_t matchEmptyOrDeleted() const { return compress(words[0], words[1]); }
+#endif
+
+    // index of the lowest set bit, mask must not be 0
+    static size_t lowest(uint32_t mask) {
+#if defined(__GNUC__)
+        return (size_t)__builtin_ctz(mask);
+#else
+        size_t i = 0;
+        while (!(mask & 1)) {
+            mask >>= 1;
+            i++;
+        }
+        return i;
+#endif
+    }
+};
+
+/**
+ * Open addressing hashtable with the interface of HashTable (Swiss table layout)
+ * Elements live in one flat slot array, with one control byte per slot: EMPTY, DELETED or 7 bits of the hash.
+ * A lookup probes 16 slots at a time, comparing their control bytes with SSE2 (or a scalar loop), and only
+ * compares keys whose 7 bits match. Groups are probed quadratically and the number of slots is a power of 2.
+ * Unlike HashTable, every rehash invalidates iterators and references, and find on a missing key returns end()
+ * The time complexity of functions are based on n and k
+ * n is the size of the hashtable
+ * k is the length of Key
+ * @tparam Key          key type
+ * @tparam Value        data type
+ * @tparam Hash         function object, return the hash value of a key
+ * @tparam KeyEqual     function object, return whether two keys are the same
+ */
+template<
+    typename Key, typename Value,
+    typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>
+>
+class FlatHashTable {
+public:
+    typedef std::pair<const Key, Value> HashNode;
+
+    /**
+     * A single directional iterator for the hashtable, skipping slots that are not full
+     */
+    class Iterator {
+    private:
+        const FlatHashTable* hashTable;
+        size_t index;               // slot of the element, or the number of slots for the end iterator
+
+        /**
+         * Increment the iterator
+         * Time complexity: Amortized O(1)
+         */
+        void increment() {
+            while (++index < hashTable->capacity && hashTable->ctrl[index] < 0) {
+            }
+        }
+
+        Iterator(const FlatHashTable* hashTable, size_t index) : hashTable(hashTable), index(index) {}
+
+    public:
+        friend class FlatHashTable;
+
+        Iterator() = delete;
+
+        Iterator(const Iterator&) = default;
+
+        Iterator& operator=(const Iterator&) = default;
+
+        Iterator& operator++() {
+            increment();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator temp = *this;
+            increment();
+            return temp;
+        }
+
+        bool operator==(const Iterator& that) const { return index == that.index; }
+
+        bool operator!=(const Iterator& that) const { return index != that.index; }
+
+        HashNode* operator->() { return hashTable->slots + index; }
+
+        HashNode& operator*() { return hashTable->slots[index]; }
+    };
+
+protected:
+    static constexpr double DEFAULT_LOAD_FACTOR = 0.875;                    // default maximum load factor is 7/8
+    static constexpr size_t DEFAULT_BUCKET_SIZE = FlatGroup::WIDTH;         // default number of slots is one group
+
+    std::vector<int8_t> ctrl;                                               // control bytes, one per slot
+    HashNode* slots;                                                        // slots, constructed where ctrl is full
+    size_t capacity;                                                        // number of slots, a power of 2
+    size_t tableSize;                                                       // number of elements
+    size_t growthLeft;                                                      // elements that fit in EMPTY slots
+    double maxLoadFactor;                                                   // maximum load factor
+    Hash hash;                                                              // hash function instance
+    KeyEqual keyEqual;                                                      // key equal function instance
+
+    /**
+     * The hash of key, mixed so that both the probe start (high bits) and the tag (low 7 bits)
+     * depend on every bit, std::hash of an integer is the integer itself
+     * Time Complexity: O(k)
+     */
+    inline size_t hashKey(const Key& key) const {
+        uint64_t h = (uint64_t)hash(key) * 0x9e3779b97f4a7c15ull;
+        return (size_t)(h ^ (h >> 32));
+    }
+
+    static int8_t tag(size_t h) { return (int8_t)(h & 0x7f); }
+
+    size_t groups() const { return capacity / FlatGroup::WIDTH; }
+
+    // the most elements capacity slots hold at the maximum load factor
+    size_t maxElements(size_t slotCount) const {
+        size_t max = (size_t)((double)slotCount * maxLoadFactor);
+        return max < slotCount ? max : slotCount - 1;
+    }
+
+    /**
+     * Find the minimum number of slots for the hashtable
+     * The minimum size must satisfy all of the following requirements:
+     * - It is not less than the parameter bucketSize
+     * - It holds tableSize elements within the maximum load factor
+     * - It is a power of 2 and at least one group
+     * Time Complexity: O(1)
+     * @throw std::range_error if no such size can be found
+     * @param bucketSize lower bound of the new number of slots
+     */
+    size_t findMinimumBucketSize(size_t bucketSize) const {
+        size_t size = DEFAULT_BUCKET_SIZE;
+        while (size < bucketSize || maxElements(size) < tableSize) {
+            if (size > (((size_t)-1) >> 2)) {
+                throw std::range_error("range_error");
+            }
+            size <<= 1;
+        }
+        return size;
+    }
+
+    /**
+     * The slot of key, or capacity if it is not in the hashtable
+     * Probing stops at the first group with an EMPTY slot
+     * Time Complexity: Amortized O(k)
+     */
+    size_t findIndex(const Key& key) const {
+        size_t h = hashKey(key);
+        size_t mask = groups() - 1;
+        size_t group = (h >> 7) & mask;
+        for (size_t step = 0; step <= mask; ++step) {
+            FlatGroup g(ctrl.data() + group * FlatGroup::WIDTH);
+            for (uint32_t match = g.match(tag(h)); match; match &= match - 1) {
+                size_t index = group * FlatGroup::WIDTH + FlatGroup::lowest(match);
+                if (keyEqual(slots[index].first, key)) {
+                    return index;
+                }
+            }
+            if (g.matchEmpty()) {
+                break;
+            }
+            group = (group + step + 1) & mask;
+        }
+        return capacity;
+    }
+
+    /**
+     * The first EMPTY or DELETED slot on the probe sequence of hash h
+     * The table always has one, since it is never filled beyond maxElements
+     * Time Complexity: Amortized O(1)
+     */
+    size_t findInsertIndex(size_t h) const {
+        size_t mask = groups() - 1;
+        size_t group = (h >> 7) & mask;
+        for (size_t step = 0; ; ++step) {
+            uint32_t free = FlatGroup(ctrl.data() + group * FlatGroup::WIDTH).matchEmptyOrDeleted();
+            if (free) {
+                return group * FlatGroup::WIDTH + FlatGroup::lowest(free);
+            }
+            group = (group + step + 1) & mask;
+        }
+    }
+
+    /**
+     * Construct <key, value> in the slot of a key known to be missing, rehashing first if no EMPTY slot is left
+     * Time Complexity: Amortized O(k)
+     * @return the slot of the new element
+     */
+    template<typename K, typename V>
+    size_t insertNew(K&& key, V&& value) {
+        size_t h = hashKey(key);
+        size_t index = findInsertIndex(h);
+        if (growthLeft == 0 && ctrl[index] == FlatGroup::EMPTY) {
+            // tombstones alone can use up the growth, then a rehash at the same size clears them
+            size_t slotCount = capacity;
+            while (maxElements(slotCount) < tableSize + 1) {
+                if (slotCount > (((size_t)-1) >> 2)) {
+                    throw std::range_error("range_error");
+                }
+                slotCount <<= 1;
+            }
+            rehashTo(slotCount, true);
+            index = findInsertIndex(h);
+        }
+        ::new((void*)(slots + index)) HashNode(std::forward<K>(key), std::forward<V>(value));
+        growthLeft -= ctrl[index] == FlatGroup::EMPTY;
+        ctrl[index] = tag(h);
+        tableSize++;
+        return index;
+    }
+
+    /**
+     * Erase the element in a full slot
+     * The slot becomes EMPTY if its group has an EMPTY slot, since no probe sequence can then have passed
+     * the group; otherwise it becomes a DELETED tombstone that keeps later probe sequences going
+     * Time Complexity: O(1)
+     */
+    void eraseIndex(size_t index) {
+        slots[index].~HashNode();
+        size_t group = index / FlatGroup::WIDTH * FlatGroup::WIDTH;
+        if (FlatGroup(ctrl.data() + group).matchEmpty()) {
+            ctrl[index] = FlatGroup::EMPTY;
+            growthLeft++;
+        }
+        else {
+            ctrl[index] = FlatGroup::DELETED;
+        }
+        tableSize--;
+    }
+
+    // allocate slotCount uninitialised slots and mark them all EMPTY
+    void allocate(size_t slotCount) {
+        capacity = slotCount;
+        ctrl.assign(slotCount, FlatGroup::EMPTY);
+        slots = std::allocator<HashNode>().allocate(slotCount);
+        growthLeft = maxElements(slotCount);
+    }
+
+    // destroy every element and free the slots
+    void release() {
+        if (!slots) {
+            return;
+        }
+        for (size_t i = 0; i < capacity; ++i) {
+            if (ctrl[i] >= 0) {
+                slots[i].~HashNode();
+            }
+        }
+        std::allocator<HashNode>().deallocate(slots, capacity);
+        slots = nullptr;
+    }
+
+    /**
+     * Move every element into a new slot array of slotCount slots
+     * Time Complexity: O(nk + slotCount)
+     */
+    void rehashTo(size_t slotCount, bool force = false) {
+        if (slotCount == capacity && !force) {
+            return;
+        }
+        std::vector<int8_t> oldCtrl;
+        oldCtrl.swap(ctrl);
+        HashNode* oldSlots = slots;
+        size_t oldCapacity = capacity;
+        allocate(slotCount);
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (oldCtrl[i] >= 0) {
+                size_t h = hashKey(oldSlots[i].first);
+                size_t index = findInsertIndex(h);
+                ::new((void*)(slots + index)) HashNode(std::move(oldSlots[i]));
+                ctrl[index] = tag(h);
+                oldSlots[i].~HashNode();
+            }
+        }
+        growthLeft -= tableSize;
+        std::allocator<HashNode>().deallocate(oldSlots, oldCapacity);
+    }
+
+    void copyfrom(const FlatHashTable& that) {
+        release();
+        tableSize = 0;
+        maxLoadFactor = that.maxLoadFactor;
+        hash = that.hash;
+        keyEqual = that.keyEqual;
+        allocate(that.capacity);
+        // same hash and same size, so every element keeps its slot
+        for (size_t i = 0; i < capacity; ++i) {
+            if (that.ctrl[i] >= 0) {
+                ::new((void*)(slots + i)) HashNode(that.slots[i]);
+                ctrl[i] = that.ctrl[i];
+                tableSize++;
+            }
+        }
+        // the tombstones too: a key may have probed past a group that was full, and now holds only DELETED,
+        // so turning them EMPTY would end its probe sequence early. growthLeft matches the copied bytes
+        ctrl = that.ctrl;
+        growthLeft = that.growthLeft;
+    }
+
+public:
+    FlatHashTable() :
+        slots(nullptr), capacity(0), tableSize(0), growthLeft(0), maxLoadFactor(DEFAULT_LOAD_FACTOR),
+        hash(Hash()), keyEqual(KeyEqual()) {
+        allocate(DEFAULT_BUCKET_SIZE);
+    }
+
+    explicit FlatHashTable(size_t bucketSize) :
+        slots(nullptr), capacity(0), tableSize(0), growthLeft(0), maxLoadFactor(DEFAULT_LOAD_FACTOR),
+        hash(Hash()), keyEqual(KeyEqual()) {
+        allocate(findMinimumBucketSize(bucketSize));
+    }
+
+    FlatHashTable(const FlatHashTable& that) :
+        slots(nullptr), capacity(0), tableSize(0), growthLeft(0), maxLoadFactor(that.maxLoadFactor) {
+        copyfrom(that);
+    }
+
+    FlatHashTable& operator=(const FlatHashTable& that) {
+        if (&that != this) {
+            copyfrom(that);
+        }
+        return *this;
+    }
+
+    ~FlatHashTable() { release(); }
+
+    /**
+     * Time Complexity: O(n / 16) to skip the leading empty slots
+     */
+    Iterator begin() {
+        Iterator it(this, (size_t)-1);
+        it.increment();
+        return it;
+    }
+
+    Iterator end() {
+        return Iterator(this, capacity);
+    }
+
+    /**
+     * Find whether the key exists in the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return whether the key exists in the hashtable
+     */
+    bool contains(const Key& key) {
+        return findIndex(key) != capacity;
+    }
+
+    /**
+     * Find the value in hashtable by key
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return an iterator of the value, end() if the key does not exist
+     */
+    Iterator find(const Key& key) {
+        return Iterator(this, findIndex(key));
+    }
+
+    /**
+     * Insert value into the hashtable according to an iterator returned by find
+     * the function can be only be called if no other write actions are done to the hashtable after the find
+     * If the key already exists, overwrite its value
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param it an iterator returned by find
+     * @param key
+     * @param value
+     * @return whether insertion took place (return false if the key already exists)
+     */
+    bool insert(const Iterator& it, const Key& key, const Value& value) {
+        if (it.index != capacity) {
+            slots[it.index].second = value;
+            return false;
+        }
+        insertNew(key, value);
+        return true;
+    }
+
+    /**
+     * Insert <key, value> into the hashtable
+     * If the key already exists, overwrite its value
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param value
+     * @return whether insertion took place (return false if the key already exists)
+     */
+    bool insert(const Key& key, const Value& value) {
+        return insert(find(key), key, value);
+    }
+
+    /**
+     * Erase the key if it exists in the hashtable, otherwise, do nothing
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return whether the key exists
+     */
+    bool erase(const Key& key) {
+        size_t index = findIndex(key);
+        if (index == capacity) {
+            return false;
+        }
+        eraseIndex(index);
+        return true;
+    }
+
+    /**
+     * Erase the key at the input iterator
+     * If the input iterator is the end iterator, do nothing and return the input iterator directly
+     * Time Complexity: Amortized O(1)
+     * @param it
+     * @return the iterator after the input iterator before the erase
+     */
+    Iterator erase(const Iterator& it) {
+        if (it.index == capacity) {
+            return it;
+        }
+        Iterator next = it;
+        next.increment();
+        eraseIndex(it.index);
+        return next;
+    }
+
+    /**
+     * Get the reference of value by key in the hashtable
+     * If the key doesn't exist, create it first (use default constructor of Value)
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return reference of value
+     */
+    Value& operator[](const Key& key) {
+        size_t index = findIndex(key);
+        if (index == capacity) {
+            index = insertNew(key, Value());
+        }
+        return slots[index].second;
+    }
+
+    /**
+     * Rehash the hashtable according to the (hinted) number of slots
+     * The number of slots after rehash need not be same as the parameter bucketSize
+     * Instead, findMinimumBucketSize is called to get the correct number
+     * Do nothing if the number of slots doesn't change
+     * Time Complexity: O(nk)
+     * @param bucketSize lower bound of the new number of slots
+     */
+    void rehash(size_t bucketSize) {
+        rehashTo(findMinimumBucketSize(bucketSize));
+    }
+
+    /**
+     * @return the number of elements in the hashtable
+     */
+    size_t size() const { return tableSize; }
+
+    /**
+     * @return the number of slots in the hashtable
+     */
+    size_t bucketSize() const { return capacity; }
+
+    /**
+     * @return the current load factor of the hashtable
+     */
+    double loadFactor() const { return (double)tableSize / (double)capacity; }
+
+    /**
+     * @return the maximum load factor of the hashtable
+     */
+    double getMaxLoadFactor() const { return maxLoadFactor; }
+
+    /**
+     * Set the max load factor
+     * @throw std::range_error if the load factor is too small, or above 1 which open addressing cannot hold
+     * @param loadFactor
+     */
+    void setMaxLoadFactor(double loadFactor) {
+        if (loadFactor <= 1e-9 || loadFactor > 1) {
+            throw std::range_error("invalid load factor!");
+        }
+        maxLoadFactor = loadFactor;
+        // rebuilt at the right size, which also recomputes growthLeft for the new factor
+        rehashTo(findMinimumBucketSize(capacity), true);
+    }
+
+};
+
+#endif //VE281P2_FLAT_HASHTABLE_HPP
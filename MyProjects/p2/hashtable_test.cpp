@@ -0,0 +1,226 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "hashtable.hpp"
+#include "flat_hashtable.hpp"
+using namespace std;
+
+// whether table holds exactly the elements of reference
+template<typename Table>
+bool same(Table &table, const unordered_map<int64_t, int64_t> &reference) {
+    if (table.size() != reference.size()) {
+        return false;
+    }
+    for (auto &element : reference) {
+        auto it = table.find(element.first);
+        if (!table.contains(element.first) || it == table.end() || it->second != element.second) {
+            return false;
+        }
+    }
+    size_t count = 0;
+    for (auto it = table.begin(); it != table.end(); ++it, ++count) {
+        auto found = reference.find(it->first);
+        if (found == reference.end() || found->second != it->second) {
+            return false;
+        }
+    }
+    return count == reference.size();
+}
+
+// random inserts and erases, so that groups fill up and leave tombstones, then copies of the table
+template<typename Table>
+bool copy_after_erase(const string &name, mt19937_64 &rng) {
+    Table table;
+    unordered_map<int64_t, int64_t> reference;
+    bool ok = true;
+    for (size_t round = 0; round < 20; ++round) {
+        for (size_t i = 0; i < 20000; ++i) {
+            int64_t key = (int64_t)(rng() % 100000);
+            if (rng() % 3) {
+                table.insert(key, (int64_t)i);
+                reference[key] = (int64_t)i;
+            }
+            else {
+                table.erase(key);
+                reference.erase(key);
+            }
+        }
+        Table copy(table);
+        Table assigned;
+        assigned.insert(-1, -1);
+        assigned = table;
+        ok = ok && same(table, reference) && same(copy, reference) && same(assigned, reference);
+        // the copies must keep working as tables of their own
+        for (size_t i = 0; i < 5000; ++i) {
+            int64_t key = (int64_t)(rng() % 100000);
+            copy.erase(key);
+            copy.insert(key + 100000, 0);
+        }
+    }
+    cout << name << " copy after erase " << (ok ? "ok" : "FAILED") << endl;
+    return ok;
+}
+
+// iterate over an incremental rehash in progress while inserting and erasing, every element that is
+// in the table all along must be visited, and an iterator must keep its element across every write
+template<typename Table>
+bool iterate_across_writes(const string &name, mt19937_64 &rng) {
+    Table table;
+    table.setIncrementalRehash(true);
+    int64_t next = 0;
+    while (table.size() < 20000 || !table.isRehashing()) {
+        table.insert(next, next);
+        next++;
+    }
+    auto first = table.begin();
+    int64_t firstKey = first->first;
+    table.insert(-1, 0);
+    bool ok = first->first == firstKey && first->second == firstKey;
+    table.erase(-1);
+
+    unordered_set<int64_t> required, visited;
+    for (int64_t key = 0; key < next; ++key) {
+        required.insert(key);
+    }
+    size_t steps = 0;
+    for (auto it = table.begin(); it != table.end() && steps < 100 * (size_t)next; ++it, ++steps) {
+        int64_t key = it->first;
+        ok = ok && it->second == key;
+        visited.insert(key);
+        // grow the table by one key every other step, so that later rehashes start during the iteration
+        if (steps % 2 == 0) {
+            table.insert(next, next);
+            next++;
+        }
+        if (steps % 5 == 0) {
+            int64_t victim = (int64_t)(rng() % (uint64_t)next);
+            if (victim != key) {
+                table.erase(victim);
+                required.erase(victim);
+            }
+        }
+        ok = ok && it->first == key;
+    }
+    for (int64_t key : required) {
+        ok = ok && visited.count(key);
+    }
+    // erasing through an iterator while the table keeps migrating
+    size_t erased = 0;
+    for (auto it = table.begin(); it != table.end(); ++erased) {
+        int64_t key = it->first;
+        if (erased % 2 == 0) {
+            table.insert(next, next);
+            next++;
+        }
+        it = table.erase(it);
+        ok = ok && !table.contains(key);
+    }
+    ok = ok && table.size() == 0;
+    cout << name << " iterate across writes, " << steps << " steps, " << visited.size() << " keys visited "
+         << (ok ? "ok" : "FAILED") << endl;
+    return ok;
+}
+
+// blocks of the pool's size are reused last freed first, blocks of any other size go to operator new,
+// and the allocators of a table and of its copies never share a pool
+bool node_pool() {
+    bool ok = true;
+    NodePool pool;
+    vector<void*> blocks;
+    for (size_t i = 0; i < 3 * NodePool::FIRST_CHUNK; ++i) {
+        blocks.push_back(pool.allocate(24, 8));
+    }
+    sort(blocks.begin(), blocks.end());
+    ok = ok && adjacent_find(blocks.begin(), blocks.end()) == blocks.end();
+    void* freed = blocks.back();
+    pool.deallocate(freed, 24, 8);
+    ok = ok && pool.allocate(24, 8) == freed;
+    void* other = pool.allocate(100, 8);
+    ok = ok && !binary_search(blocks.begin(), blocks.end(), other);
+    pool.deallocate(other, 100, 8);
+
+    PoolAllocator<int64_t> a;
+    PoolAllocator<int64_t> b(a);
+    PoolAllocator<double> rebound(a);
+    ok = ok && a == b && a == rebound && a != PoolAllocator<int64_t>();
+
+    unordered_map<int64_t, int64_t> reference;
+    PooledHashTable<int64_t, int64_t> assigned;
+    auto assignedAllocator = assigned.getAllocator();
+    {
+        PooledHashTable<int64_t, int64_t> table;
+        for (int64_t key = 0; key < 1000; ++key) {
+            table.insert(key, key);
+            reference[key] = key;
+        }
+        PooledHashTable<int64_t, int64_t> copy(table);
+        assigned = table;
+        ok = ok && copy.getAllocator() != table.getAllocator() && assigned.getAllocator() != table.getAllocator();
+        ok = ok && assigned.getAllocator() == assignedAllocator;
+    }
+    // the source is gone, so a copy still using its pool would write to freed memory
+    for (int64_t key = 1000; key < 2000; ++key) {
+        assigned.insert(key, key);
+        reference[key] = key;
+    }
+    ok = ok && same(assigned, reference);
+    cout << "node pool " << (ok ? "ok" : "FAILED") << endl;
+    return ok;
+}
+
+// std::hash that counts its calls, one per element a rehash moves
+size_t hash_calls = 0;
+
+struct CountingHash {
+    size_t operator()(int64_t key) const {
+        hash_calls++;
+        return std::hash<int64_t>()(key);
+    }
+};
+
+// the most hash calls and the longest time of a single insert at a low load factor, where the table grows
+// after few inserts, so an incremental rehash has to move more than the default step per write to end in time
+bool insert_latency_at_low_load_factor(size_t n) {
+    bool ok = true;
+    for (bool incremental : {false, true}) {
+        HashTable<int64_t, int64_t, CountingHash> table;
+        table.setIncrementalRehash(incremental);
+        table.setMaxLoadFactor(0.05);
+        size_t worstCalls = 0;
+        double worstMs = 0;
+        for (size_t i = 0; i < n; ++i) {
+            size_t calls = hash_calls;
+            auto start = chrono::steady_clock::now();
+            // distinct keys spread over all buckets, consecutive ones would fill the first buckets only
+            table.insert((int64_t)(i * 0x9e3779b97f4a7c15ull), (int64_t)i);
+            worstMs = max(worstMs, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+            worstCalls = max(worstCalls, hash_calls - calls);
+        }
+        // the lookup of the new key, then about one moved element per insert
+        bool bounded = worstCalls <= 64;
+        if (incremental) {
+            ok = ok && bounded && table.size() == n;
+        }
+        cout << "hashtable insert at load factor 0.05, " << (incremental ? "incremental" : "full") << " rehash: worst "
+             << worstCalls << " hash calls, " << worstMs << " ms" << (incremental && !bounded ? " FAILED" : "") << endl;
+    }
+    return ok;
+}
+
+int main() {
+    mt19937_64 rng(281);
+    bool ok = true;
+    ok = copy_after_erase<HashTable<int64_t, int64_t> >("hashtable", rng) && ok;
+    ok = copy_after_erase<FlatHashTable<int64_t, int64_t> >("flat_hashtable", rng) && ok;
+    ok = copy_after_erase<PooledHashTable<int64_t, int64_t> >("pooled_hashtable", rng) && ok;
+    ok = iterate_across_writes<HashTable<int64_t, int64_t> >("hashtable", rng) && ok;
+    ok = iterate_across_writes<PooledHashTable<int64_t, int64_t> >("pooled_hashtable", rng) && ok;
+    ok = node_pool() && ok;
+    ok = insert_latency_at_low_load_factor(300000) && ok;
+    return ok ? 0 : 1;
+}
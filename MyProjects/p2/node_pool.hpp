@@ -0,0 +1,168 @@
+#ifndef VE281P2_NODE_POOL_HPP
+#define VE281P2_NODE_POOL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * A slab allocator for blocks of one size, the nodes of one container
+ * Blocks are cut from chunks that double in size, freed blocks go to a free list and are reused first,
+ * and every chunk is released at once when the pool is destroyed
+ * The block size is fixed by the first allocation, requests of any other size go to operator new
+ * Not thread-safe: the containers sharing a pool must be used from one thread at a time
+ */
+class NodePool {
+public:
+    static constexpr size_t FIRST_CHUNK = 64;           // blocks in the first chunk
+    static constexpr size_t MAX_CHUNK = 1 << 16;        // blocks in the largest chunk
+
+    size_t owners = 0;              // PoolAllocator instances using the pool, the last one deletes it
+
+    NodePool() = default;
+
+    NodePool(const NodePool&) = delete;
+
+    NodePool& operator=(const NodePool&) = delete;
+
+    ~NodePool() {
+        for (void* chunk : chunks) {
+            ::operator delete(chunk);
+        }
+    }
+
+    /**
+     * Time Complexity: O(1) amortized
+     * @param size bytes of the block
+     * @param align alignment of the block, at most alignof(std::max_align_t)
+     */
+    void* allocate(size_t size, size_t align) {
+        if (blockSize == 0) {
+            blockSize = roundedSize(size, align);
+            blockAlign = align;
+        }
+        if (roundedSize(size, align) != blockSize || align != blockAlign) {
+            return ::operator new(size);
+        }
+        if (!freeList) {
+            refill();
+        }
+        void* block = freeList;
+        freeList = *static_cast<void**>(block);
+        return block;
+    }
+
+    /**
+     * Time Complexity: O(1)
+     */
+    void deallocate(void* block, size_t size, size_t align) {
+        if (roundedSize(size, align) != blockSize || align != blockAlign) {
+            ::operator delete(block);
+            return;
+        }
+        *static_cast<void**>(block) = freeList;
+        freeList = block;
+    }
+
+private:
+    std::vector<void*> chunks;      // every chunk allocated, released by the destructor
+    void* freeList = nullptr;       // the first free block, every free block starts with the next one
+    size_t blockSize = 0;
+    size_t blockAlign = 0;
+    size_t chunkBlocks = FIRST_CHUNK;
+
+    // a block holds the object or, while free, the pointer to the next free block
+    static size_t roundedSize(size_t size, size_t align) {
+        align = std::max(align, alignof(void*));
+        return (std::max(size, sizeof(void*)) + align - 1) / align * align;
+    }
+
+    // add a chunk, linked so that its blocks are handed out in address order
+    void refill() {
+        char* chunk = static_cast<char*>(::operator new(chunkBlocks * blockSize));
+        chunks.push_back(chunk);
+        for (size_t i = chunkBlocks; i-- > 0;) {
+            *reinterpret_cast<void**>(chunk + i * blockSize) = freeList;
+            freeList = chunk + i * blockSize;
+        }
+        chunkBlocks = std::min(chunkBlocks * 2, (size_t)MAX_CHUNK);
+    }
+};
+
+/**
+ * Allocator handing out single objects from a shared NodePool, for node based containers
+ * Copies and rebound copies share the pool, and compare equal exactly when they do,
+ * so nodes can be spliced between containers built from copies of one allocator
+ * The pool is reference counted without atomics, every bucket of a HashTable holds a copy
+ * Arrays and over-aligned types go to std::allocator
+ * @tparam T    value type
+ */
+template<typename T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_copy_assignment;     // copy assignment keeps the target's pool
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    typedef std::false_type is_always_equal;
+
+    PoolAllocator() : pool(new NodePool()) {
+        pool->owners++;
+    }
+
+    PoolAllocator(const PoolAllocator& that) noexcept : pool(that.pool) {
+        pool->owners++;
+    }
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>& that) noexcept : pool(that.pool) {
+        pool->owners++;
+    }
+
+    PoolAllocator& operator=(const PoolAllocator& that) noexcept {
+        that.pool->owners++;
+        release();
+        pool = that.pool;
+        return *this;
+    }
+
+    ~PoolAllocator() { release(); }
+
+    T* allocate(size_t n) {
+        if (n != 1 || alignof(T) > alignof(std::max_align_t)) {
+            return std::allocator<T>().allocate(n);
+        }
+        return static_cast<T*>(pool->allocate(sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (n != 1 || alignof(T) > alignof(std::max_align_t)) {
+            std::allocator<T>().deallocate(p, n);
+            return;
+        }
+        pool->deallocate(p, sizeof(T), alignof(T));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>& that) const { return pool == that.pool; }
+
+    template<typename U>
+    bool operator!=(const PoolAllocator<U>& that) const { return pool != that.pool; }
+
+private:
+    template<typename U>
+    friend class PoolAllocator;
+
+    NodePool* pool;
+
+    void release() {
+        if (--pool->owners == 0) {
+            delete pool;
+        }
+    }
+};
+
+#endif //VE281P2_NODE_POOL_HPP